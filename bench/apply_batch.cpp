@@ -0,0 +1,75 @@
+// Throughput of apply_batch() versus applying the same mixed batch of
+// insert/assign/erase ops one by one, across map size, batch size and how
+// much of the key range the batch touches (spread 1 is the whole map,
+// 1/100 a band holding a hundredth of it). The last column is the speedup.
+// apply_batch() wins on maps too large for the cache with batches spread
+// over them (map=1000000, spread 1/1 or 1/10); on smaller maps, or with
+// batches confined to a narrow band, the descents it saves are cache hits
+// and sorting the batch costs more than they do.
+// Build: g++ -std=c++17 -O2 -I../src apply_batch.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+typedef sjtu::map<int, int> Map;
+typedef Map::batch_op Op;
+
+static void applyOneByOne(Map &map, const std::vector<Op> &ops) {
+    for (const Op &op : ops) {
+        if (op.kind == Op::erase) {
+            map.erase(op.key);
+        } else if (op.kind == Op::assign) {
+            map[op.key] = op.value;
+        } else {
+            map.insert(sjtu::pair<const int, int>(op.key, op.value));
+        }
+    }
+}
+
+static void applyBatched(Map &map, const std::vector<Op> &ops) {
+    map.apply_batch(ops.data(), ops.size());
+}
+
+// Best of three runs, each on a fresh copy of `map`.
+template<class Apply>
+static double timeBatch(const Map &map, const std::vector<Op> &ops, Apply apply) {
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        Map copy = map;
+        auto start = std::chrono::steady_clock::now();
+        apply(copy, ops);
+        double ns = elapsedNs(start);
+        if (round == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+int main() {
+    const int mapSizes[] = {100000, 1000000};
+    const int batchSizes[] = {1000, 10000, 100000};
+    const int spreads[] = {1, 10, 100};
+    std::mt19937 rng(7);
+    for (int n : mapSizes) {
+        Map map;
+        for (int i = 0; i < n; ++i) map[i * 4] = i;
+        for (int k : batchSizes) {
+            for (int spread : spreads) {
+                int width = 4 * n / spread;
+                int base = (int)(rng() % (4 * n - width + 1));
+                std::vector<Op> ops;
+                for (int i = 0; i < k; ++i) {
+                    Op op = {(Op::kind_type)(rng() % 3), base + (int)(rng() % width), i};
+                    ops.push_back(op);
+                }
+                double loop = timeBatch(map, ops, applyOneByOne);
+                double batch = timeBatch(map, ops, applyBatched);
+                printf("map=%-8d batch=%-7d spread=1/%-4d one-by-one ns/op=%7.1f  apply_batch ns/op=%7.1f  x%.2f\n",
+                       n, k, spread, loop / k, batch / k, loop / batch);
+            }
+        }
+    }
+    return 0;
+}
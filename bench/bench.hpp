@@ -0,0 +1,14 @@
+/**
+* timing helpers shared by the benchmarks
+*/
+#ifndef SJTU_BENCH_HPP
+#define SJTU_BENCH_HPP
+
+#include <chrono>
+
+// Nanoseconds from `start` until now.
+inline double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif
@@ -0,0 +1,42 @@
+// find() on int keys with random hits and misses, as in data/two and
+// data/three: std::less<int> takes the branchless, prefetching descent,
+// and an equivalent hand-written comparator keeps the generic one.
+// Build: g++ -std=c++17 -O2 -I../src branchless_find.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+struct GenericLess {
+    bool operator()(int a, int b) const { return a < b; }
+};
+
+template<class Compare>
+static double findNs(int n, const std::vector<int> &keys, const std::vector<int> &probes, long long &sink) {
+    sjtu::map<int, int, Compare> map;
+    for (int i = 0; i < n; ++i) map[keys[i]] = i;
+    auto start = std::chrono::steady_clock::now();
+    for (int probe : probes) {
+        typename sjtu::map<int, int, Compare>::iterator it = map.find(probe);
+        if (it != map.end()) sink += it->second;
+    }
+    return elapsedNs(start) / probes.size();
+}
+
+int main() {
+    const int sizes[] = {1000, 50000, 1000000, 4000000};
+    long long sink = 0;
+    for (int n : sizes) {
+        std::mt19937 rng(n);
+        std::vector<int> keys(n), probes(2000000);
+        for (int &key : keys) key = (int)(rng() % (2u * n));
+        for (int &probe : probes) probe = (int)(rng() % (2u * n));
+        double generic = findNs<GenericLess>(n, keys, probes, sink);
+        double branchless = findNs<std::less<int> >(n, keys, probes, sink);
+        printf("n=%-8d ns/find: generic %6.1f  branchless %6.1f\n", n, generic, branchless);
+    }
+    printf("(check %lld)\n", sink);
+    return 0;
+}
@@ -0,0 +1,50 @@
+// Time per element to fill a map from a snapshot: repeated insert() versus
+// the range constructor on sorted and shuffled input.
+// Build: g++ -std=c++17 -O2 -I../src bulk_build.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+typedef sjtu::map<int, int> Map;
+typedef sjtu::pair<const int, int> Value;
+
+template<class Fill>
+static void report(const char *name, const std::vector<Value> &values, Fill fill) {
+    auto start = std::chrono::steady_clock::now();
+    size_t size = fill(values);
+    double ns = elapsedNs(start);
+    printf("%-24s n=%-8zu size=%-8zu ns/element=%7.1f\n", name, values.size(), size, ns / values.size());
+}
+
+static size_t byInsert(const std::vector<Value> &values) {
+    Map map;
+    for (const Value &v : values) map.insert(v);
+    return map.size();
+}
+
+static size_t byRange(const std::vector<Value> &values) {
+    Map map(values.begin(), values.end());
+    return map.size();
+}
+
+int main() {
+    const int sizes[] = {1000, 100000, 1000000};
+    std::mt19937 rng(42);
+    for (int n : sizes) {
+        std::vector<Value> sorted, shuffled;
+        std::vector<int> keys(n);
+        for (int i = 0; i < n; ++i) keys[i] = i;
+        for (int k : keys) sorted.push_back(Value(k, k));
+        std::shuffle(keys.begin(), keys.end(), rng);
+        for (int k : keys) shuffled.push_back(Value(k, k));
+        report("sorted, insert()", sorted, byInsert);
+        report("sorted, range ctor", sorted, byRange);
+        report("shuffled, insert()", shuffled, byInsert);
+        report("shuffled, range ctor", shuffled, byRange);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+// Expiring a window of keys: erase(it++) in a loop versus erase(first, last)
+// and erase_range(lo, hi).
+// Build: g++ -std=c++17 -O2 -I../src erase_range.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cstdio>
+
+typedef sjtu::map<int, int> Map;
+
+static void fill(Map &map, int n) {
+    for (int i = 0; i < n; ++i) map[i] = i;
+}
+
+// Erases up to 100 disjoint windows of `k` keys spread over the map.
+template<class Erase>
+static void report(const char *name, int n, int k, Erase erase) {
+    Map map;
+    fill(map, n);
+    int windows = n / k / 2 < 100 ? (n / k + 1) / 2 : 100;
+    int stride = n / windows;
+    auto start = std::chrono::steady_clock::now();
+    for (int w = 0; w < windows; ++w) {
+        erase(map, w * stride, w * stride + k);
+    }
+    double ns = elapsedNs(start);
+    printf("%-20s map=%-8d window=%-7d x%-4d size after=%-8zu ns/erased=%7.1f\n",
+           name, n, k, windows, map.size(), ns / ((double)k * windows));
+}
+
+static void loopErase(Map &map, int lo, int hi) {
+    Map::iterator it = map.find(lo), last = map.find(hi);
+    while (it != last) map.erase(it++);
+}
+
+static void iteratorErase(Map &map, int lo, int hi) {
+    map.erase(map.find(lo), map.find(hi));
+}
+
+static void keyErase(Map &map, int lo, int hi) {
+    map.erase_range(lo, hi);
+}
+
+int main() {
+    const int n = 1000000;
+    const int windowSizes[] = {4, 16, 64, 1000, 100000, 900000};
+    for (int k : windowSizes) {
+        report("erase(it++) loop", n, k, loopErase);
+        report("erase(first, last)", n, k, iteratorErase);
+        report("erase_range(lo, hi)", n, k, keyErase);
+    }
+    return 0;
+}
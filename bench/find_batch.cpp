@@ -0,0 +1,48 @@
+// Throughput of many independent lookups: a loop of find() versus
+// find_batch(), on int keys and on string keys, up to maps well past the
+// last-level cache. Pass a size in millions to run only that size, e.g.
+// ./a.out 16.
+// Build: g++ -std=c++17 -O2 -I../src find_batch.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+template<class Key, class MakeKey>
+static void report(const char *name, int n, MakeKey makeKey) {
+    std::mt19937 rng(n);
+    sjtu::map<Key, int> map;
+    for (int i = 0; i < n; ++i) map[makeKey((int)(rng() % (2u * n)))] = i;
+    std::vector<Key> probes;
+    for (int i = 0; i < 1000000; ++i) probes.push_back(makeKey((int)(rng() % (2u * n))));
+
+    long long hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const Key &probe : probes) hits += map.find(probe) != map.end();
+    double single = elapsedNs(start) / probes.size();
+
+    std::vector<size_t> counts(probes.size());
+    start = std::chrono::steady_clock::now();
+    map.count_batch(probes.begin(), probes.end(), counts.begin());
+    double batched = elapsedNs(start) / probes.size();
+    for (size_t c : counts) hits -= (long long)c;
+
+    printf("%-6s n=%-9d ns/lookup: find %7.1f  count_batch %7.1f  speedup %.2fx  (check %lld)\n",
+           name, n, single, batched, single / batched, hits);
+}
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes = {100000, 1000000, 4000000, 16000000};
+    if (argc > 1) sizes = {(int)(atof(argv[1]) * 1000000)};
+    for (int n : sizes) {
+        report<int>("int", n, [](int k) { return k; });
+        if (n <= 4000000) {
+            report<std::string>("string", n, [](int k) { return "key-" + std::to_string(k) + "-padding"; });
+        }
+    }
+    return 0;
+}
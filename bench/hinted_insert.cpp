@@ -0,0 +1,85 @@
+// Comparator calls and time per insert for hinted vs. unhinted insertion
+// on sorted and nearly sorted streams.
+// Build: g++ -std=c++17 -O2 -I../src hinted_insert.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+static long long calls = 0;
+
+struct CountingLess {
+    bool operator()(int a, int b) const {
+        ++calls;
+        return a < b;
+    }
+};
+
+typedef sjtu::map<int, int, CountingLess> Map;
+typedef sjtu::pair<const int, int> Value;
+
+static unsigned long long state = 88172645463325252ULL;
+
+static unsigned nextRandom() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (unsigned)(state >> 33);
+}
+
+// 0..n-1 with `swaps` random adjacent-ish transpositions.
+static std::vector<int> nearlySorted(int n, int swaps) {
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; ++i) keys[i] = i;
+    for (int i = 0; i < swaps; ++i) {
+        int a = nextRandom() % n;
+        int b = std::min(n - 1, a + 1 + (int)(nextRandom() % 8));
+        std::swap(keys[a], keys[b]);
+    }
+    return keys;
+}
+
+template<class Fill>
+static void report(const char *name, const std::vector<int> &keys, Fill fill) {
+    Map map;
+    calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    fill(map, keys);
+    double ns = elapsedNs(start);
+    printf("%-28s n=%-8zu cmp/insert=%6.2f  ns/insert=%7.1f\n",
+           name, keys.size(), (double)calls / keys.size(), ns / keys.size());
+}
+
+static void plain(Map &m, const std::vector<int> &keys) {
+    for (int k : keys) m.insert(Value(k, k));
+}
+
+static void hintEnd(Map &m, const std::vector<int> &keys) {
+    for (int k : keys) m.insert(m.end(), Value(k, k));
+}
+
+// The usual idiom for a stream: hint with the successor of the last insert.
+static void hintNext(Map &m, const std::vector<int> &keys) {
+    Map::iterator hint = m.end();
+    for (int k : keys) {
+        hint = m.insert(hint, Value(k, k));
+        ++hint;
+    }
+}
+
+int main() {
+    const int sizes[] = {1000, 100000, 1000000};
+    for (int n : sizes) {
+        std::vector<int> sorted = nearlySorted(n, 0);
+        std::vector<int> nearly = nearlySorted(n, n / 100);
+        report("sorted, no hint", sorted, plain);
+        report("sorted, hint end()", sorted, hintEnd);
+        report("sorted, hint next", sorted, hintNext);
+        report("nearly sorted, no hint", nearly, plain);
+        report("nearly sorted, hint end()", nearly, hintEnd);
+        report("nearly sorted, hint next", nearly, hintNext);
+    }
+    return 0;
+}
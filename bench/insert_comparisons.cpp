@@ -0,0 +1,51 @@
+// Comparator calls per inserted key for insert() and operator[].
+// Build: g++ -std=c++17 -O2 -I../src insert_comparisons.cpp
+#include "map.hpp"
+#include <cmath>
+#include <cstdio>
+
+static long long calls = 0;
+
+struct CountingLess {
+    bool operator()(int a, int b) const {
+        ++calls;
+        return a < b;
+    }
+};
+
+static unsigned long long state = 88172645463325252ULL;
+
+static int nextRandom() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (int)(state >> 33);
+}
+
+template<class Fill>
+static void report(const char *name, int n, Fill fill) {
+    sjtu::map<int, int, CountingLess> map;
+    calls = 0;
+    fill(map, n);
+    printf("%-22s n=%-8d size=%-8zu cmp/insert=%6.2f  log2(n)=%5.2f\n",
+           name, n, map.size(), (double)calls / n, std::log2((double)n));
+}
+
+int main() {
+    const int sizes[] = {1000, 100000, 1000000};
+    for (int n : sizes) {
+        report("insert, sequential", n, [](sjtu::map<int, int, CountingLess> &m, int cnt) {
+            for (int i = 0; i < cnt; ++i) m.insert(sjtu::pair<const int, int>(i, i));
+        });
+        report("insert, descending", n, [](sjtu::map<int, int, CountingLess> &m, int cnt) {
+            for (int i = cnt; i > 0; --i) m.insert(sjtu::pair<const int, int>(i, i));
+        });
+        report("insert, random", n, [](sjtu::map<int, int, CountingLess> &m, int cnt) {
+            for (int i = 0; i < cnt; ++i) m.insert(sjtu::pair<const int, int>(nextRandom(), i));
+        });
+        report("operator[], random", n, [](sjtu::map<int, int, CountingLess> &m, int cnt) {
+            for (int i = 0; i < cnt; ++i) m[nextRandom()] = i;
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Comparator calls and time per find() on string keys that share a long
+// prefix, so each comparison is expensive: a plain less-than comparator
+// (one call per level, equality checked once at the bottom) versus one
+// exposing a three-way compare() (one call per level, stops at the match).
+// Build: g++ -std=c++17 -O2 -I../src lookup_comparisons.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+static long long calls = 0;
+
+struct CountingLess {
+    bool operator()(const std::string &a, const std::string &b) const {
+        ++calls;
+        return a < b;
+    }
+};
+
+struct CountingThreeWay {
+    bool operator()(const std::string &a, const std::string &b) const {
+        ++calls;
+        return a < b;
+    }
+    int compare(const std::string &a, const std::string &b) const {
+        ++calls;
+        return a.compare(b);
+    }
+};
+
+static std::string makeKey(int i) {
+    char digits[16];
+    snprintf(digits, sizeof digits, "%09d", i);
+    return std::string("tenant/eu-west/bucket/objects/") + digits;
+}
+
+template<class Compare>
+static void report(const char *name, int n, const std::vector<std::string> &probes) {
+    sjtu::map<std::string, int, Compare> map;
+    for (int i = 0; i < n; ++i) map.insert(sjtu::pair<const std::string, int>(makeKey(2 * i), i));
+    calls = 0;
+    long long found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string &probe : probes) found += map.find(probe) != map.end();
+    double ns = elapsedNs(start) / probes.size();
+    printf("%-10s n=%-8d cmp/find=%6.2f  ns/find=%6.1f  log2(n)=%5.2f  (hits %lld)\n",
+           name, n, (double)calls / probes.size(), ns, std::log2((double)n), found);
+}
+
+int main() {
+    const int sizes[] = {1000, 100000, 1000000};
+    for (int n : sizes) {
+        std::mt19937 rng(n);
+        std::vector<std::string> probes;
+        for (int i = 0; i < 200000; ++i) probes.push_back(makeKey((int)(rng() % (2 * n))));
+        report<CountingLess>("less", n, probes);
+        report<CountingThreeWay>("three-way", n, probes);
+    }
+    return 0;
+}
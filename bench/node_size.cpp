@@ -0,0 +1,57 @@
+// Bytes per element and map object size for a few value types, for
+// sjtu::map and the index-linked sjtu::arena_map.
+// Build: g++ -std=c++17 -O2 -I../src node_size.cpp
+// Add -DSJTU_MAP_NO_POINTER_TAGGING to compare with the untagged layout.
+#include "map.hpp"
+#include "arena_map.hpp"
+#include <cstdio>
+#include <memory>
+#include <string>
+
+static size_t liveBytes = 0;
+
+template<class T>
+struct CountingAllocator {
+    typedef T value_type;
+    CountingAllocator() {}
+    template<class U> CountingAllocator(const CountingAllocator<U> &) {}
+    T *allocate(size_t n) {
+        liveBytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T *p, size_t n) {
+        liveBytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+    template<class U> bool operator==(const CountingAllocator<U> &) const { return true; }
+    template<class U> bool operator!=(const CountingAllocator<U> &) const { return false; }
+};
+
+template<class K, class V>
+using Map = sjtu::map<K, V, std::less<K>, CountingAllocator<sjtu::pair<const K, V> > >;
+
+template<class K, class V>
+using ArenaMap = sjtu::arena_map<K, V, std::less<K>, CountingAllocator<sjtu::pair<const K, V> > >;
+
+template<class M>
+static void report(const char *name, int n) {
+    typedef typename std::remove_const<decltype(M::value_type::first)>::type K;
+    typedef decltype(M::value_type::second) V;
+    liveBytes = 0;
+    M map;
+    for (int i = 0; i < n; ++i) map.insert(typename M::value_type(K(i), V()));
+    printf("%-24s sizeof(map)=%-3zu sizeof(value)=%-3zu bytes/element=%6.2f\n",
+           name, sizeof(M), sizeof(typename M::value_type), (double)liveBytes / n);
+}
+
+int main() {
+    const int n = 1000000;
+    report<Map<int, int> >("map<int, int>", n);
+    report<Map<int, char> >("map<int, char>", n);
+    report<Map<long long, long long> >("map<long long, long long>", n);
+    report<Map<int, std::string> >("map<int, std::string>", n);
+    report<ArenaMap<int, int> >("arena_map<int, int>", n);
+    report<ArenaMap<long long, long long> >("arena_map<ll, ll>", n);
+    report<ArenaMap<int, std::string> >("arena_map<int, std::string>", n);
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Percentiles over a latency map: select() with the order_statistics
+// policy versus walking iterators, plus what the policy costs on insert.
+// Build: g++ -std=c++17 -O2 -I../src order_statistics.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+typedef sjtu::map<int, int> Plain;
+typedef sjtu::map<int, int, std::less<int>, std::allocator<sjtu::pair<const int, int> >,
+                  sjtu::order_statistics> Ranked;
+
+template<class Map>
+static double fill(Map &map, int n) {
+    std::mt19937 rng(3);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) map[(int)(rng() % (10 * n))] = i;
+    return elapsedNs(start) / n;
+}
+
+int main() {
+    const int n = 1000000;
+    const double percentiles[] = {0.5, 0.9, 0.99, 0.999};
+    Plain plain;
+    Ranked ranked;
+    double plainInsert = fill(plain, n);
+    double rankedInsert = fill(ranked, n);
+    printf("insert ns/op: no_augment %.1f  order_statistics %.1f\n", plainInsert, rankedInsert);
+
+    long long sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (double p : percentiles) {
+        size_t k = (size_t)(p * plain.size());
+        Plain::const_iterator it = plain.cbegin();
+        for (size_t i = 0; i < k; ++i) ++it;
+        sink += it->first;
+    }
+    double walk = elapsedNs(start) / 4;
+    start = std::chrono::steady_clock::now();
+    for (double p : percentiles) {
+        sink -= ranked.select((size_t)(p * ranked.size()))->first;
+    }
+    double select = elapsedNs(start) / 4;
+    printf("percentile ns/query: iterator walk %.0f  select %.0f  (check %lld)\n", walk, select, sink);
+    return 0;
+}
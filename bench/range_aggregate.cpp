@@ -0,0 +1,57 @@
+// Windowed sums over a series keyed by sample index: aggregate(lo, hi)
+// with a range_aggregate<sum_of> policy versus summing an iterator walk,
+// plus what keeping the sums costs on a point write.
+// Build: g++ -std=c++17 -O2 -I../src range_aggregate.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+typedef sjtu::map<int, long long> Plain;
+typedef sjtu::map<int, long long, std::less<int>, std::allocator<sjtu::pair<const int, long long> >,
+                  sjtu::range_aggregate<sjtu::sum_of<long long> > > Summed;
+
+int main() {
+    const int n = 1000000, queries = 2000;
+    const int windows[] = {100, 10000, 500000};
+    Plain plain;
+    Summed summed;
+    std::mt19937 rng(5);
+    for (int i = 0; i < n; ++i) {
+        plain.insert_or_assign(i, (long long)(rng() % 1000));
+        summed.insert_or_assign(i, plain.at(i));
+    }
+
+    rng.seed(7);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) plain.at((int)(rng() % n)) += 1;
+    double plainWrite = elapsedNs(start) / n;
+    rng.seed(7);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) summed.update((int)(rng() % n), [](long long &value) { value += 1; });
+    double summedWrite = elapsedNs(start) / n;
+    printf("point write ns/op: plain %.1f  update() %.1f\n", plainWrite, summedWrite);
+
+    long long sink = 0;
+    for (int window : windows) {
+        rng.seed(11);
+        start = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; ++q) {
+            int lo = (int)(rng() % (n - window));
+            Plain::const_iterator it = plain.find(lo);
+            for (int i = 0; i < window; ++i, ++it) sink += it->second;
+        }
+        double walk = elapsedNs(start) / queries;
+        rng.seed(11);
+        start = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; ++q) {
+            int lo = (int)(rng() % (n - window));
+            sink -= summed.aggregate(lo, lo + window);
+        }
+        double aggregate = elapsedNs(start) / queries;
+        printf("window %6d ns/query: iterator walk %.0f  aggregate %.0f\n", window, walk, aggregate);
+    }
+    printf("(check %lld, expect 0)\n", sink);
+    return 0;
+}
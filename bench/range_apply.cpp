@@ -0,0 +1,58 @@
+// Corrections of the form "add delta to every value with a key in
+// [lo, hi)": range_apply() with a range_update<affine> policy versus an
+// iterator loop, plus what the tags cost on point reads.
+// Build: g++ -std=c++17 -O2 -I../src range_apply.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+typedef sjtu::affine<long long> Affine;
+typedef sjtu::map<int, long long> Plain;
+typedef sjtu::map<int, long long, std::less<int>, std::allocator<sjtu::pair<const int, long long> >,
+                  sjtu::range_update<Affine> > Lazy;
+
+int main() {
+    const int n = 1000000, updates = 2000;
+    const int windows[] = {100, 10000, 500000};
+    Plain plain;
+    Lazy lazy;
+    for (int i = 0; i < n; ++i) {
+        plain[i] = i;
+        lazy.insert_or_assign(i, (long long)i);
+    }
+
+    std::mt19937 rng(7);
+    for (int window : windows) {
+        rng.seed(11);
+        auto start = std::chrono::steady_clock::now();
+        for (int q = 0; q < updates; ++q) {
+            int lo = (int)(rng() % (n - window));
+            Plain::iterator it = plain.find(lo);
+            for (int i = 0; i < window; ++i, ++it) it->second += q;
+        }
+        double loop = elapsedNs(start) / updates;
+        rng.seed(11);
+        start = std::chrono::steady_clock::now();
+        for (int q = 0; q < updates; ++q) {
+            int lo = (int)(rng() % (n - window));
+            lazy.range_apply(lo, lo + window, Affine::add(q));
+        }
+        double tagged = elapsedNs(start) / updates;
+        printf("window %6d ns/update: iterator loop %.0f  range_apply %.0f\n", window, loop, tagged);
+    }
+
+    long long sink = 0;
+    rng.seed(13);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) sink += plain.at((int)(rng() % n));
+    double plainRead = elapsedNs(start) / n;
+    rng.seed(13);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) sink -= lazy.at((int)(rng() % n));
+    double lazyRead = elapsedNs(start) / n;
+    printf("point read ns/op: plain %.1f  range_update %.1f  (check %lld, expect 0)\n",
+           plainRead, lazyRead, sink);
+    return 0;
+}
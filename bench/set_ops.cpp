@@ -0,0 +1,85 @@
+// Combining a large map with a smaller one: merge_union / intersection /
+// difference versus the element-by-element loops they replace, across the
+// size ratios where the set operations switch from split/join to walking
+// the smaller map, for cheap (int) and expensive (std::string) keys.
+// Build: g++ -std=c++17 -O2 -I../src set_ops.cpp
+#include "map.hpp"
+#include "bench.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+static std::mt19937 rng(1);
+
+template<class Key>
+static Key makeKey(int x);
+
+template<>
+int makeKey<int>(int x) {
+    return x;
+}
+
+template<>
+std::string makeKey<std::string>(int x) {
+    char text[32];
+    snprintf(text, sizeof(text), "item-%010d", x);
+    return text;
+}
+
+template<class Key>
+static void fill(sjtu::map<Key, int> &map, int n, int range) {
+    while ((int)map.size() < n) map[makeKey<Key>((int)(rng() % range))] = 1;
+}
+
+template<class Map, class Op>
+static double timeOp(const Map &target, const Map &other, Op op) {
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        Map a = target;
+        Map b = other;
+        auto start = std::chrono::steady_clock::now();
+        op(a, b);
+        double us = elapsedNs(start) / 1000;
+        if (round == 0 || us < best) best = us;
+    }
+    return best;
+}
+
+template<class Key>
+static void run(const char *name, int n) {
+    typedef sjtu::map<Key, int> Map;
+    typedef typename Map::iterator Iterator;
+    const int ratios[] = {1, 2, 3, 4, 6, 8, 12, 16, 100};
+    Map big;
+    fill(big, n, 4 * n);
+    for (int ratio : ratios) {
+        int m = n / ratio;
+        Map small;
+        fill(small, m, 4 * n);
+        double loopUnion = timeOp(big, small, [](Map &a, Map &b) {
+            for (Iterator it = b.begin(); it != b.end(); ++it) a.insert(*it);
+        });
+        double setUnion = timeOp(big, small, [](Map &a, Map &b) { a.merge_union(std::move(b)); });
+        double loopInter = timeOp(small, big, [](Map &a, Map &b) {
+            for (Iterator it = a.begin(); it != a.end();) {
+                if (b.count(it->first)) ++it; else a.erase(it++);
+            }
+        });
+        double setInter = timeOp(small, big, [](Map &a, Map &b) { a.intersection(b); });
+        double loopDiff = timeOp(big, small, [](Map &a, Map &b) {
+            for (Iterator it = b.begin(); it != b.end(); ++it) a.erase(it->first);
+        });
+        double setDiff = timeOp(big, small, [](Map &a, Map &b) { a.difference(b); });
+        printf("%-6s n=%-7d m=%-7d union: loop %8.0fus set %8.0fus | intersection: loop %8.0fus set %8.0fus"
+               " | difference: loop %8.0fus set %8.0fus\n",
+               name, n, m, loopUnion, setUnion, loopInter, setInter, loopDiff, setDiff);
+    }
+}
+
+int main() {
+    run<int>("int", 100000);
+    run<int>("int", 1000000);
+    run<std::string>("string", 300000);
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include "map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+long globalNews = 0;
+
+void *operator new(size_t size) {
+	++globalNews;
+	if (void *p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	std::free(p);
+}
+
+// Takes memory from malloc, so global new only counts what bypasses it.
+template<class T>
+struct MallocAllocator {
+	typedef T value_type;
+	static long allocations;
+
+	MallocAllocator() {}
+	template<class U>
+	MallocAllocator(const MallocAllocator<U> &) {}
+
+	T *allocate(size_t n) {
+		++allocations;
+		return static_cast<T*>(std::malloc(n * sizeof(T)));
+	}
+
+	void deallocate(T *p, size_t) {
+		std::free(p);
+	}
+
+	template<class U>
+	bool operator==(const MallocAllocator<U> &) const { return true; }
+	template<class U>
+	bool operator!=(const MallocAllocator<U> &) const { return false; }
+};
+
+template<class T>
+long MallocAllocator<T>::allocations = 0;
+
+typedef sjtu::map<int, std::string> Map;
+typedef Map::batch_op Op;
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+void print(const Map &map) {
+	for (auto it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << ":" << it->second << " ";
+	}
+	std::cout << map.size() << std::endl;
+}
+
+bool same(const Map &map, const std::map<int, std::string> &expected) {
+	if (map.size() != expected.size()) return false;
+	auto it = map.cbegin();
+	for (auto &p : expected) {
+		if (it->first != p.first || it->second != p.second) return false;
+		++it;
+	}
+	return it == map.cend();
+}
+
+void applyOne(std::map<int, std::string> &map, const Op &op) {
+	if (op.kind == Op::erase) {
+		map.erase(op.key);
+	} else if (op.kind == Op::assign) {
+		map[op.key] = op.value;
+	} else {
+		map.insert(std::make_pair(op.key, op.value));
+	}
+}
+
+void testOrder() {
+	// Ops on one key apply in array order.
+	Map map;
+	map[5] = "five";
+	Op ops[] = {
+		{Op::insert, 1, "a"}, {Op::insert, 1, "b"}, {Op::assign, 2, "c"},
+		{Op::erase, 1, ""}, {Op::insert, 3, "d"}, {Op::assign, 3, "e"},
+		{Op::erase, 9, ""}, {Op::insert, 5, "ignored"}, {Op::assign, 1, "f"},
+	};
+	map.apply_batch(ops, sizeof(ops) / sizeof(ops[0]));
+	print(map);
+	map.apply_batch(ops, 0);
+	print(map);
+}
+
+void testRandom() {
+	// Batches small and large next to the map, so both the finger descents
+	// and the rebuild are used.
+	int sizes[] = {0, 10, 1000, 20000};
+	int batches[] = {1, 15, 500, 5000};
+	for (int size : sizes) {
+		for (int batch : batches) {
+			Map map;
+			std::map<int, std::string> expected;
+			int range = size * 2 + 50;
+			for (int i = 0; i < size; ++i) {
+				int key = nextRand() % range;
+				map[key] = std::to_string(i);
+				expected[key] = std::to_string(i);
+			}
+			std::vector<Op> ops;
+			for (int i = 0; i < batch; ++i) {
+				Op op = {(Op::kind_type)(nextRand() % 3), nextRand() % range, std::to_string(-i)};
+				ops.push_back(op);
+				applyOne(expected, op);
+			}
+			map.apply_batch(ops.data(), ops.size());
+			std::cout << size << " " << batch << " " << map.size() << " " << same(map, expected) << std::endl;
+		}
+	}
+}
+
+void testBands() {
+	// Batches confined to a band of keys, dense or sparse within it, so the
+	// band is merged in place or the ops descend one by one.
+	int widths[] = {50, 500, 5000, 40000};
+	int batches[] = {100, 2000};
+	for (int width : widths) {
+		for (int batch : batches) {
+			Map map;
+			std::map<int, std::string> expected;
+			for (int i = 0; i < 20000; ++i) {
+				map[i * 2] = std::to_string(i);
+				expected[i * 2] = std::to_string(i);
+			}
+			int base = nextRand() % (40000 - width + 1);
+			std::vector<Op> ops;
+			for (int i = 0; i < batch; ++i) {
+				Op op = {(Op::kind_type)(nextRand() % 3), base + (nextRand() * 32768 + nextRand()) % width, std::to_string(-i)};
+				ops.push_back(op);
+				applyOne(expected, op);
+			}
+			map.apply_batch(ops.data(), ops.size());
+			std::cout << width << " " << batch << " " << map.size() << " " << same(map, expected) << std::endl;
+		}
+	}
+
+	// String keys walk sparse bands with a finger.
+	typedef sjtu::map<std::string, int> Named;
+	typedef Named::batch_op NamedOp;
+	Named named;
+	std::map<std::string, int> reference;
+	for (int i = 0; i < 5000; ++i) {
+		named[std::to_string(100000 + i * 3)] = i;
+		reference[std::to_string(100000 + i * 3)] = i;
+	}
+	std::vector<NamedOp> ops;
+	for (int i = 0; i < 200; ++i) {
+		NamedOp op = {(NamedOp::kind_type)(nextRand() % 3), std::to_string(100000 + nextRand() % 6000), -i};
+		ops.push_back(op);
+		if (op.kind == NamedOp::erase) {
+			reference.erase(op.key);
+		} else if (op.kind == NamedOp::assign) {
+			reference[op.key] = op.value;
+		} else {
+			reference.insert(std::make_pair(op.key, op.value));
+		}
+	}
+	named.apply_batch(ops.data(), ops.size());
+	bool ok = named.size() == reference.size();
+	auto it = named.cbegin();
+	for (auto &p : reference) {
+		if (!ok) break;
+		ok = it->first == p.first && it->second == p.second;
+		++it;
+	}
+	std::cout << named.size() << " " << ok << std::endl;
+}
+
+void testAllocator() {
+	// The scratch space for sorting the batch comes from the map's allocator.
+	typedef sjtu::map<int, int, std::less<int>, MallocAllocator<sjtu::pair<const int, int> > > Malloced;
+	typedef Malloced::batch_op IntOp;
+	Malloced map;
+	for (int i = 0; i < 1000; ++i) {
+		map[i * 2] = i;
+	}
+	std::vector<IntOp> ops;
+	for (int i = 0; i < 3000; ++i) {
+		IntOp op = {(IntOp::kind_type)(i % 3), nextRand() % 4000, i};
+		ops.push_back(op);
+	}
+	long news = globalNews;
+	map.apply_batch(ops.data(), ops.size());
+	std::cout << map.size() << " " << globalNews - news << std::endl;
+}
+
+int main(void) {
+	testOrder();
+	testRandom();
+	testBands();
+	testAllocator();
+}
@@ -0,0 +1,203 @@
+#include "arena_map.hpp"
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+long comparisons = 0;
+
+class CountingLess {
+public:
+	bool operator () (int lhs, int rhs) const {
+		comparisons++;
+		return lhs < rhs;
+	}
+};
+
+typedef sjtu::arena_map<int, std::string, CountingLess> Map;
+typedef Map::value_type Value;
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+// Walks the map both ways against `expected`.
+int mismatches(const Map &map, const std::map<int, std::string> &expected) {
+	int count = map.size() != expected.size();
+	auto it = map.cbegin();
+	for (auto &p : expected) {
+		if (it == map.cend() || it->first != p.first || it->second != p.second) return count + 1;
+		++it;
+	}
+	if (it != map.cend()) return count + 1;
+	for (auto p = expected.rbegin(); p != expected.rend(); ++p) {
+		--it;
+		if (it->first != p->first) return count + 1;
+	}
+	return count;
+}
+
+// find() makes at most two comparisons per level: is the tree within the
+// AVL height bound?
+bool balanced(const Map &map) {
+	long most = 0;
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		comparisons = 0;
+		map.find(it->first);
+		if (comparisons > most) most = comparisons;
+	}
+	return most <= 2 * 1.4405 * std::log2(map.size() + 2.0);
+}
+
+void testRandom() {
+	Map map;
+	std::map<int, std::string> expected;
+	int wrong = 0;
+	for (int i = 0; i < 200000; ++i) {
+		int key = nextRand() % 10000;
+		std::string value = std::to_string(i);
+		switch (nextRand() % 8) {
+			case 0: case 1:
+				if (map.insert(Value(key, value)).second != expected.emplace(key, value).second) ++wrong;
+				break;
+			case 2:
+				map[key] = value;
+				expected[key] = value;
+				break;
+			case 3:
+				if (map.try_emplace(key, value).second != expected.emplace(key, value).second) ++wrong;
+				break;
+			case 4:
+				map.insert_or_assign(key, value);
+				expected[key] = value;
+				break;
+			case 5: {
+				Map::iterator it = map.find(key);
+				if ((it == map.end()) != (expected.count(key) == 0)) {
+					++wrong;
+				} else if (it != map.end()) {
+					Map::iterator next = it;
+					++next;
+					if (map.erase(it) != next) ++wrong;
+					expected.erase(key);
+				}
+				break;
+			}
+			case 6:
+				if (map.erase(key) != expected.erase(key)) ++wrong;
+				break;
+			default:
+				if (map.count(key) != expected.count(key)) ++wrong;
+				if (expected.count(key) && map.at(key) != expected[key]) ++wrong;
+		}
+	}
+	std::cout << map.size() << " " << wrong << " " << mismatches(map, expected) << " " << balanced(map) << std::endl;
+	for (int i = 0; i < 10000; ++i) {
+		map.erase(i);
+	}
+	std::cout << map.size() << " " << (map.begin() == map.end()) << std::endl;
+}
+
+// Iterators hold indices, so they survive the arena growing under them;
+// arguments that alias elements are read before the old arena goes.
+void testGrowth() {
+	Map map;
+	std::vector<Map::iterator> kept;
+	for (int i = 0; i < 5000; ++i) {
+		kept.push_back(map.insert(Value(i * 2, std::to_string(i))).first);
+	}
+	int wrong = 0;
+	for (int i = 0; i < 5000; ++i) {
+		if (kept[i]->first != i * 2 || kept[i]->second != std::to_string(i) || map.find(i * 2) != kept[i]) ++wrong;
+	}
+	Map small;
+	small[0] = std::string(40, 'a');
+	for (int i = 1; i < 1000; ++i) {
+		small.try_emplace(i, small.at(i - 1));
+		small.insert_or_assign(-i, small.at(i));
+	}
+	std::cout << wrong << " " << small.size() << " " << (small.at(-999) == std::string(40, 'a')) << std::endl;
+}
+
+void testCopyMoveSwap() {
+	Map a, b;
+	std::map<int, std::string> expectA, expectB;
+	for (int i = 0; i < 300; ++i) {
+		int key = nextRand() % 1000;
+		a[key] = expectA[key] = "a" + std::to_string(i);
+		key = nextRand() % 1000;
+		b[key] = expectB[key] = "b" + std::to_string(i);
+		if (i % 3 == 0) {
+			a.erase(nextRand() % 1000);
+		}
+	}
+	expectA.clear();
+	for (Map::iterator it = a.begin(); it != a.end(); ++it) expectA[it->first] = it->second;
+
+	Map copy(a);
+	copy[5000] = "only in copy";
+	Map assigned;
+	assigned[1] = "old";
+	assigned = b;
+	std::cout << mismatches(a, expectA) << " " << (copy.size() == a.size() + 1) << " "
+	          << a.count(5000) << " " << mismatches(assigned, expectB) << std::endl;
+
+	Map::iterator inA = a.begin();
+	int firstKey = inA->first;
+	a.swap(b);
+	std::cout << mismatches(a, expectB) << " " << mismatches(b, expectA) << " " << (inA->first == firstKey)
+	          << std::endl;
+
+	Map moved(std::move(a));
+	std::cout << mismatches(moved, expectB) << " " << a.size() << " " << a.count(1) << " "
+	          << (a.begin() == a.end()) << std::endl;
+	a[7] = "again";
+	a = std::move(b);
+	std::cout << mismatches(a, expectA) << " " << b.size() << std::endl;
+	b = a;
+	b.clear();
+	b[1] = "after clear";
+	std::cout << b.size() << " " << b.at(1) << " " << balanced(moved) << std::endl;
+}
+
+void testErrors() {
+	Map map;
+	map[1] = "one";
+	try {
+		map.erase(map.end());
+		std::cout << "no exception" << std::endl;
+	} catch (sjtu::invalid_iterator &) {
+		std::cout << "invalid_iterator" << std::endl;
+	}
+	Map other;
+	try {
+		map.erase(other.end());
+		std::cout << "no exception" << std::endl;
+	} catch (sjtu::invalid_iterator &) {
+		std::cout << "invalid_iterator" << std::endl;
+	}
+	try {
+		map.at(2);
+		std::cout << "no exception" << std::endl;
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "index_out_of_bound" << std::endl;
+	}
+	try {
+		Map::iterator it = map.begin();
+		--it;
+		std::cout << "no exception" << std::endl;
+	} catch (sjtu::invalid_iterator &) {
+		std::cout << "invalid_iterator" << std::endl;
+	}
+}
+
+int main(void) {
+	testRandom();
+	testGrowth();
+	testCopyMoveSwap();
+	testErrors();
+}
@@ -0,0 +1,77 @@
+#include "map.hpp"
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+
+typedef sjtu::map<int, std::string> Map;
+typedef std::map<int, std::string> Reference;
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+template<class Iterator>
+std::string show(const Iterator &it, const Iterator &end) {
+	return it == end ? std::string("end") : std::to_string(it->first);
+}
+
+void testSmall() {
+	Map map;
+	for (int i = 1; i <= 5; ++i) {
+		map[i * 10] = std::to_string(i);
+	}
+	const Map &constant = map;
+	int keys[] = {5, 10, 25, 50, 55};
+	for (int key : keys) {
+		auto range = map.equal_range(key);
+		auto constRange = constant.equal_range(key);
+		std::cout << key << ": " << show(map.lower_bound(key), map.end()) << " "
+		          << show(map.upper_bound(key), map.end()) << " "
+		          << show(range.first, map.end()) << "-" << show(range.second, map.end()) << " "
+		          << show(constRange.first, constant.cend()) << "-" << show(constRange.second, constant.cend()) << " "
+		          << show(map.floor(key), map.end()) << " " << show(constant.floor(key), constant.cend()) << " "
+		          << show(map.ceiling(key), map.end()) << " " << show(constant.ceiling(key), constant.cend())
+		          << std::endl;
+	}
+	map.lower_bound(20)->second = "two";
+	std::cout << map.at(20) << std::endl;
+
+	Map empty;
+	std::cout << (empty.lower_bound(1) == empty.end()) << (empty.upper_bound(1) == empty.end())
+	          << (empty.floor(1) == empty.end()) << (empty.ceiling(1) == empty.end()) << std::endl;
+}
+
+void testRandom() {
+	Map map;
+	Reference expected;
+	int mismatches = 0;
+	for (int i = 0; i < 5000; ++i) {
+		int key = nextRand() % 20000;
+		map[key] = "";
+		expected[key] = "";
+	}
+	for (int q = 0; q < 20000; ++q) {
+		int key = nextRand() % 20100 - 50;
+		auto lower = expected.lower_bound(key), upper = expected.upper_bound(key);
+		if (show(map.lower_bound(key), map.end()) != show(lower, expected.end())) ++mismatches;
+		if (show(map.upper_bound(key), map.end()) != show(upper, expected.end())) ++mismatches;
+		auto range = map.equal_range(key);
+		if (show(range.first, map.end()) != show(lower, expected.end()) ||
+		    show(range.second, map.end()) != show(upper, expected.end())) {
+			++mismatches;
+		}
+		std::string floor = upper == expected.begin() ? "end" : std::to_string(std::prev(upper)->first);
+		if (show(map.floor(key), map.end()) != floor) ++mismatches;
+		if (show(map.ceiling(key), map.end()) != show(lower, expected.end())) ++mismatches;
+	}
+	std::cout << map.size() << " " << mismatches << std::endl;
+}
+
+int main(void) {
+	testSmall();
+	testRandom();
+}
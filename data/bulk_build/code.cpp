@@ -0,0 +1,129 @@
+#include "map.hpp"
+#include <cmath>
+#include <iostream>
+#include <list>
+#include <map>
+#include <vector>
+
+long comparisons = 0;
+
+class CountingLess {
+public:
+	bool operator () (int lhs, int rhs) const {
+		comparisons++;
+		return lhs < rhs;
+	}
+};
+
+typedef sjtu::map<int, int, CountingLess> Map;
+typedef Map::value_type Value;
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+// The most comparisons any successful find() needs: one per level plus the
+// final check, so it measures the height of the tree.
+int deepestFind(const Map &map) {
+	long most = 0;
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		comparisons = 0;
+		map.find(it->first);
+		if (comparisons > most) most = comparisons;
+	}
+	return most;
+}
+
+// std::map::insert keeps the first of equal keys too.
+std::map<int, int> expect(const std::vector<Value> &values) {
+	std::map<int, int> expected;
+	for (auto &v : values) expected.insert(std::make_pair(v.first, v.second));
+	return expected;
+}
+
+int mismatches(const Map &map, const std::map<int, int> &expected) {
+	auto it = map.cbegin();
+	for (auto &p : expected) {
+		if (it == map.cend() || it->first != p.first || it->second != p.second) return 1;
+		++it;
+	}
+	return (it != map.cend()) + (map.size() != expected.size());
+}
+
+// Random inserts and erases rely on the built tree's balance factors and
+// parent links; an AVL tree of n nodes is at most 1.44 log2(n + 2) high.
+void churn(Map &map, std::map<int, int> expected) {
+	for (int i = 0; i < 20000; ++i) {
+		int key = nextRand() % 4000;
+		if (nextRand() % 2) {
+			map[key] = i;
+			expected[key] = i;
+		} else {
+			map.erase(key);
+			expected.erase(key);
+		}
+	}
+	double bound = 1.4405 * std::log2(map.size() + 2.0) + 1;
+	std::cout << "  after churn: " << mismatches(map, expected) << " " << (deepestFind(map) <= bound) << std::endl;
+}
+
+void report(const char *name, Map &map, const std::vector<Value> &values, long buildComparisons) {
+	std::map<int, int> expected = expect(values);
+	std::cout << name << ": " << map.size() << " " << mismatches(map, expected) << " " << buildComparisons
+	          << " " << deepestFind(map) << std::endl;
+	churn(map, expected);
+}
+
+int main(void) {
+	std::vector<Value> sorted, unsorted, duplicates, sortedDuplicates;
+	for (int i = 0; i < 1000; ++i) {
+		sorted.push_back(Value(i * 3, i));
+		unsorted.push_back(Value(nextRand() % 100000, i));
+		duplicates.push_back(Value(nextRand() % 500, i));
+	}
+	for (int i = 0; i < 1000; ++i) {
+		sortedDuplicates.push_back(Value(i / 3, i));
+	}
+
+	comparisons = 0;
+	Map fromSorted(sorted.begin(), sorted.end());
+	report("sorted", fromSorted, sorted, comparisons);
+
+	comparisons = 0;
+	Map fromUnsorted(unsorted.begin(), unsorted.end());
+	report("unsorted", fromUnsorted, unsorted, comparisons > 0);
+
+	comparisons = 0;
+	Map fromDuplicates(duplicates.begin(), duplicates.end());
+	report("duplicates", fromDuplicates, duplicates, comparisons > 0);
+
+	// A forward-only range that is sorted apart from runs of equal keys.
+	std::list<Value> listed(sortedDuplicates.begin(), sortedDuplicates.end());
+	comparisons = 0;
+	Map fromList(listed.begin(), listed.end());
+	report("sorted duplicates", fromList, sortedDuplicates, comparisons > 0);
+
+	Map assigned;
+	assigned[-1] = -1;
+	comparisons = 0;
+	assigned.assign_sorted(sorted.begin(), sorted.begin() + 100);
+	std::vector<Value> prefix(sorted.begin(), sorted.begin() + 100);
+	report("assign_sorted", assigned, prefix, comparisons);
+	assigned.assign_sorted(sorted.end(), sorted.end());
+	std::cout << "assign empty: " << assigned.size() << " " << (assigned.begin() == assigned.end()) << std::endl;
+
+	Map listInit = {Value(5, 0), Value(1, 1), Value(3, 2), Value(1, 3), Value(4, 4)};
+	for (Map::iterator it = listInit.begin(); it != listInit.end(); ++it) {
+		std::cout << it->first << ":" << it->second << " ";
+	}
+	std::cout << listInit.size() << std::endl;
+
+	for (int n = 0; n <= 8; ++n) {
+		Map small(sorted.begin(), sorted.begin() + n);
+		std::cout << deepestFind(small) << " ";
+	}
+	std::cout << std::endl;
+}
@@ -9,7 +9,10 @@ namespace Util {
 
 const size_t MIN_CAPACITY = 2048;
 
+struct BintPrefix;
+
 class Bint {
+	friend struct BintPrefix;
 	class NewSpaceFailed : public std::runtime_error {
 	public:
 		NewSpaceFailed();
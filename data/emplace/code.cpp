@@ -0,0 +1,138 @@
+#include "map.hpp"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+
+// Counts how each object came to be.
+class Counted {
+public:
+	static int built, copied, moved;
+	int value;
+
+	explicit Counted(int value = 0) : value(value) {
+		built++;
+	}
+
+	Counted(int a, int b) : value(a * b) {
+		built++;
+	}
+
+	Counted(const Counted &rhs) : value(rhs.value) {
+		copied++;
+	}
+
+	Counted(Counted &&rhs) noexcept : value(rhs.value) {
+		rhs.value = -1;
+		moved++;
+	}
+
+	Counted &operator=(const Counted &rhs) {
+		value = rhs.value;
+		copied++;
+		return *this;
+	}
+
+	Counted &operator=(Counted &&rhs) noexcept {
+		value = rhs.value;
+		rhs.value = -1;
+		moved++;
+		return *this;
+	}
+
+	static void reset() {
+		built = copied = moved = 0;
+	}
+
+	static void report(const char *what) {
+		std::cout << what << ": built " << built << " copied " << copied << " moved " << moved << std::endl;
+		reset();
+	}
+};
+
+int Counted::built = 0, Counted::copied = 0, Counted::moved = 0;
+
+class Less {
+public:
+	bool operator () (const Counted &lhs, const Counted &rhs) const {
+		return lhs.value < rhs.value;
+	}
+};
+
+void testCopies() {
+	typedef sjtu::map<Counted, Counted, Less> Map;
+	typedef Map::value_type Value;
+	Map map;
+	Counted::reset();
+
+	map.emplace(std::piecewise_construct, std::forward_as_tuple(1), std::forward_as_tuple(2, 3));
+	Counted::report("emplace piecewise");
+	map.try_emplace(Counted(2), 4, 5);
+	Counted::report("try_emplace");
+	map.emplace(Counted(3), Counted(6));
+	Counted::report("emplace values");
+	Value value(Counted(4), Counted(8));
+	Counted::report("pair forwarding");
+	// The key of a value_type is const, so moving one copies the key.
+	map.insert(std::move(value));
+	Counted::report("insert rvalue");
+	Value copy(Counted(5), Counted(10));
+	Counted::reset();
+	map.insert(copy);
+	Counted::report("insert lvalue");
+	map[Counted(6)] = Counted(12);
+	Counted::report("rvalue operator[]");
+	map.emplace_hint(map.end(), std::piecewise_construct, std::forward_as_tuple(7), std::forward_as_tuple(14));
+	Counted::report("emplace_hint");
+	sjtu::pair<Counted, Counted> other(Counted(8), Counted(16));
+	Counted::reset();
+	map.insert(Value(std::move(other)));
+	Counted::report("converted pair");
+	map.try_emplace(Counted(1), 99);
+	Counted::report("try_emplace present");
+
+	for (Map::iterator it = map.begin(); it != map.end(); ++it) {
+		std::cout << it->first.value << ":" << it->second.value << " ";
+	}
+	std::cout << std::endl;
+}
+
+void testMoveOnly() {
+	typedef sjtu::map<int, std::unique_ptr<int> > Map;
+	typedef Map::value_type Value;
+	Map map;
+	map.emplace(1, std::unique_ptr<int>(new int(10)));
+	map.insert(Value(2, std::unique_ptr<int>(new int(20))));
+	map[3] = std::unique_ptr<int>(new int(30));
+	map.try_emplace(4, new int(40));
+	map.insert_or_assign(5, std::unique_ptr<int>(new int(50)));
+	map.emplace_hint(map.begin(), 0, std::unique_ptr<int>(new int(0)));
+	std::unique_ptr<int> spare(new int(-1));
+	auto present = map.try_emplace(1, std::move(spare));
+	std::cout << present.second << " " << (spare != nullptr) << std::endl;
+	map.insert_or_assign(1, std::move(spare));
+	map.erase(2);
+
+	Map moved(std::move(map));
+	Map assigned;
+	assigned = std::move(moved);
+	for (Map::iterator it = assigned.begin(); it != assigned.end(); ++it) {
+		std::cout << it->first << ":" << *it->second << " ";
+	}
+	std::cout << assigned.size() << " " << map.size() << std::endl;
+}
+
+void testStrings() {
+	// A value moved in keeps its buffer.
+	sjtu::map<int, std::string> map;
+	std::string text(100, 'x');
+	const char *buffer = text.data();
+	auto result = map.emplace(1, std::move(text));
+	std::cout << (result.first->second.data() == buffer) << " " << result.first->second.size() << std::endl;
+}
+
+int main(void) {
+	testCopies();
+	testMoveOnly();
+	testStrings();
+}
@@ -0,0 +1,122 @@
+#include "map.hpp"
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <string>
+#include <vector>
+
+class PrefixLess {
+public:
+	bool operator () (const std::string &lhs, const std::string &rhs) const {
+		return lhs < rhs;
+	}
+};
+
+namespace sjtu {
+
+template<>
+struct key_prefix<std::string, PrefixLess> : string_prefix {};
+
+}
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+// Compares find_batch() and count_batch() on `keys` with one find() and
+// count() per key, and prints the hits and the mismatches.
+template<class Map, class Keys>
+void check(Map &map, const Keys &keys) {
+	const Map &constMap = map;
+	std::vector<typename Map::iterator> found;
+	std::vector<typename Map::const_iterator> constFound;
+	std::vector<size_t> counts;
+	map.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+	constMap.find_batch(keys.begin(), keys.end(), std::back_inserter(constFound));
+	constMap.count_batch(keys.begin(), keys.end(), std::back_inserter(counts));
+	int hits = 0, mismatches = 0;
+	if (found.size() != keys.size() || constFound.size() != keys.size() || counts.size() != keys.size()) {
+		std::cout << "wrong size" << std::endl;
+		return;
+	}
+	size_t i = 0;
+	for (auto &key : keys) {
+		if (found[i] != map.find(key)) ++mismatches;
+		if (constFound[i] != constMap.find(key)) ++mismatches;
+		if (counts[i] != constMap.count(key)) ++mismatches;
+		hits += counts[i];
+		++i;
+	}
+	std::cout << keys.size() << " " << hits << " " << mismatches << std::endl;
+}
+
+std::string word(int n) {
+	std::string text = "shared-prefix-";
+	for (; n > 0; n /= 7) {
+		text += char('a' + n % 7);
+	}
+	return text;
+}
+
+int main(void) {
+	sjtu::map<int, int> map;
+	std::vector<int> keys;
+	check(map, keys);
+	for (int i = 0; i < 77; ++i) {
+		keys.push_back(nextRand() % 100);
+	}
+	check(map, keys);
+	for (int i = 0; i < 5000; ++i) {
+		int key = nextRand() % 20000;
+		map[key] = i;
+	}
+	check(map, keys);
+	keys.clear();
+	for (int i = 0; i < 1000; ++i) {
+		keys.push_back(nextRand() % 25000 - 2500);
+	}
+	check(map, keys);
+
+	// A list is only a forward range, and its size is not a multiple of the
+	// batch width.
+	std::list<int> listed(keys.begin(), keys.begin() + 33);
+	check(map, listed);
+
+	// Writes found values back through the batched iterators.
+	std::vector<sjtu::map<int, int>::iterator> hits;
+	map.find_batch(keys.begin(), keys.begin() + 100, std::back_inserter(hits));
+	int written = 0;
+	for (auto &it : hits) {
+		if (it != map.end()) {
+			it->second = -1;
+		}
+	}
+	for (auto &p : map) {
+		written += p.second == -1;
+	}
+	std::cout << written << std::endl;
+
+	sjtu::map<std::string, int, PrefixLess> prefixed;
+	std::vector<std::string> words;
+	for (int i = 0; i < 3000; ++i) {
+		prefixed[word(nextRand() % 5000)] = i;
+	}
+	for (int i = 0; i < 500; ++i) {
+		words.push_back(word(nextRand() % 6000));
+	}
+	check(prefixed, words);
+
+	sjtu::map<std::string, int, std::less<> > transparent;
+	for (int i = 0; i < 3000; ++i) {
+		transparent[word(nextRand() % 5000)] = i;
+	}
+	std::vector<const char *> texts;
+	for (auto &text : words) {
+		texts.push_back(text.c_str());
+	}
+	check(transparent, texts);
+}
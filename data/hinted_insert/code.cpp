@@ -0,0 +1,128 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <vector>
+
+long comparisons = 0;
+
+class CountingLess {
+public:
+	bool operator () (int lhs, int rhs) const {
+		comparisons++;
+		return lhs < rhs;
+	}
+};
+
+typedef sjtu::map<int, int, CountingLess> Map;
+typedef Map::value_type Value;
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+template<class Expected>
+int mismatches(const Map &map, const Expected &expected) {
+	int count = 0;
+	auto it = map.cbegin();
+	for (auto &p : expected) {
+		if (it == map.cend() || it->first != p.first || it->second != p.second) {
+			return count + 1;
+		}
+		++it;
+	}
+	return count + (it != map.cend()) + (map.size() != expected.size());
+}
+
+// The "hint = next(inserted)" idiom on ascending input: every hint is
+// end(), and stepping past the last element reaches it directly.
+void testAppend() {
+	Map map;
+	Map::iterator hint = map.end();
+	comparisons = 0;
+	for (int i = 0; i < 10000; ++i) {
+		hint = map.insert(hint, Value(i, i));
+		++hint;
+		if (hint != map.end()) {
+			std::cout << "next(inserted) is not end()" << std::endl;
+			return;
+		}
+	}
+	std::cout << map.size() << " " << (comparisons <= 2 * 10000) << std::endl;
+
+	// Descending input with the inserted element itself as the hint.
+	Map down;
+	hint = down.end();
+	comparisons = 0;
+	for (int i = 10000; i > 0; --i) {
+		hint = down.emplace_hint(hint, i, -i);
+	}
+	std::cout << down.size() << " " << (comparisons <= 2 * 10000) << " " << down.begin()->second << std::endl;
+}
+
+// Hints that are wrong, end(), begin(), stale or from another map still
+// insert at the right place, and a present key is returned, not replaced.
+void testAnyHint() {
+	Map map, foreign;
+	std::map<int, int> expected;
+	for (int i = 0; i < 100; ++i) foreign[i * 7] = i;
+	std::vector<Map::iterator> seen;
+	int wrongReturns = 0;
+	for (int i = 0; i < 20000; ++i) {
+		int key = nextRand() % 3000, value = nextRand();
+		Map::const_iterator hint;
+		switch (nextRand() % 6) {
+			case 0: hint = map.end(); break;
+			case 1: hint = map.begin(); break;
+			case 2: hint = foreign.find(key / 7 * 7 % 700); break;
+			case 3: hint = map.lower_bound(key); break;
+			case 4: hint = map.upper_bound(key); break;
+			default: hint = seen.empty() ? map.cend() : Map::const_iterator(seen[nextRand() % seen.size()]);
+		}
+		bool present = expected.count(key) != 0;
+		Map::iterator it = nextRand() % 2 ? map.insert(hint, Value(key, value)) : map.emplace_hint(hint, key, value);
+		expected.emplace(key, value);
+		if (it->first != key || it->second != expected[key]) ++wrongReturns;
+		if (!present) seen.push_back(it);
+		if (nextRand() % 4 == 0) {
+			int gone = nextRand() % 3000;
+			if (map.erase(gone)) {
+				expected.erase(gone);
+				for (size_t j = 0; j < seen.size(); ++j) {
+					if (seen[j]->first == gone) {
+						seen[j] = seen.back();
+						seen.pop_back();
+						break;
+					}
+				}
+			}
+		}
+	}
+	std::cout << map.size() << " " << wrongReturns << " " << mismatches(map, expected) << " "
+	          << foreign.size() << std::endl;
+}
+
+// The last element steps to end(), and back again.
+void testStepToEnd() {
+	Map map;
+	Map::iterator hint = map.end();
+	for (int i = 0; i < 50; i += 5) {
+		hint = map.insert(hint, Value(i, i));
+		++hint;
+	}
+	Map::iterator last = map.find(45);
+	Map::iterator after = last;
+	++after;
+	Map::iterator before = after;
+	--before;
+	std::cout << (after == map.end()) << " " << (before == last) << " " << (last++ == map.find(45)) << " "
+	          << (last == map.end()) << std::endl;
+}
+
+int main(void) {
+	testAppend();
+	testAnyHint();
+	testStepToEnd();
+}
@@ -0,0 +1,233 @@
+#include "map.hpp"
+#include "../class-bint.hpp"
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+long comparisons = 0;
+
+class CountingLess {
+public:
+	bool operator () (const std::string &lhs, const std::string &rhs) const {
+		comparisons++;
+		return lhs < rhs;
+	}
+};
+
+// Same order, but without a key_prefix hook.
+class PlainLess : public CountingLess {};
+
+// A version number ordered by major, then minor. Its prefix is only the
+// major number, so keys often tie on it.
+struct Version {
+	int major, minor;
+};
+
+class VersionLess {
+public:
+	bool operator () (const Version &lhs, const Version &rhs) const {
+		comparisons++;
+		return lhs.major != rhs.major ? lhs.major < rhs.major : lhs.minor < rhs.minor;
+	}
+};
+
+class BintLess {
+public:
+	bool operator () (const Util::Bint &lhs, const Util::Bint &rhs) const {
+		comparisons++;
+		return lhs < rhs;
+	}
+};
+
+class PlainBintLess : public BintLess {};
+
+namespace Util {
+
+// Sign, length in limbs and the top two limbs, in the order Bint's
+// operator< uses: non-negative values first by magnitude, then negative
+// ones from the largest magnitude down. Limbs are below 10000, 14 bits.
+struct BintPrefix {
+	static std::uint64_t get(const Bint &b) {
+		std::uint64_t length = b.length < 0x7fffffff ? b.length : 0x7fffffff;
+		std::uint64_t top = b.data[b.length - 1], next = b.length > 1 ? b.data[b.length - 2] : 0;
+		std::uint64_t magnitude = length << 28 | top << 14 | next;
+		return b.isMinus ? std::uint64_t(1) << 63 | ((std::uint64_t(1) << 59) - 1 - magnitude) : magnitude;
+	}
+};
+
+}
+
+namespace sjtu {
+
+template<>
+struct key_prefix<std::string, CountingLess> : string_prefix {};
+
+template<>
+struct key_prefix<Util::Bint, BintLess> : Util::BintPrefix {};
+
+template<>
+struct key_prefix<Version, VersionLess> {
+	static std::uint64_t get(const Version &version) {
+		return std::uint64_t(std::int64_t(version.major) - std::numeric_limits<int>::min());
+	}
+};
+
+}
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+// Keys that share long prefixes, differ in length, and use bytes above
+// 0x7f and zero bytes, where a signed or unpadded prefix would misorder.
+std::string randomKey() {
+	static const char alphabet[] = {'a', 'b', '\0', '\x80', '\xff'};
+	std::string key = nextRand() % 2 ? "common-prefix/" : "";
+	int length = nextRand() % 12;
+	for (int i = 0; i < length; ++i) {
+		key += alphabet[nextRand() % 5];
+	}
+	return key;
+}
+
+template<class Iterator>
+std::string show(const Iterator &it, const Iterator &end) {
+	return it == end ? std::string("end") : it->first;
+}
+
+void testStrings() {
+	sjtu::map<std::string, int, CountingLess> map;
+	sjtu::map<std::string, int, PlainLess> plain;
+	std::map<std::string, int> expected;
+	std::vector<std::string> queries;
+	for (int i = 0; i < 3000; ++i) {
+		std::string key = randomKey();
+		map[key] = i;
+		plain[key] = i;
+		expected[key] = i;
+	}
+	for (int q = 0; q < 5000; ++q) {
+		queries.push_back(randomKey());
+	}
+	comparisons = 0;
+	for (auto &key : queries) plain.find(key);
+	long plainComparisons = comparisons;
+	comparisons = 0;
+	for (auto &key : queries) map.find(key);
+	bool filtered = comparisons < plainComparisons;
+	int mismatches = 0;
+	for (auto &key : queries) {
+		auto found = expected.find(key);
+		auto it = map.find(key);
+		if (found == expected.end() ? it != map.end() : it == map.end() || it->second != found->second) {
+			++mismatches;
+		}
+		if (map.count(key) != expected.count(key)) ++mismatches;
+		auto lower = expected.lower_bound(key), upper = expected.upper_bound(key);
+		if (show(map.lower_bound(key), map.end()) != show(lower, expected.end())) ++mismatches;
+		if (show(map.upper_bound(key), map.end()) != show(upper, expected.end())) ++mismatches;
+		std::string floor = upper == expected.begin() ? "end" : std::prev(upper)->first;
+		if (show(map.floor(key), map.end()) != floor) ++mismatches;
+	}
+	for (int i = 0; i < 1000; ++i) {
+		std::string key = randomKey();
+		if (map.erase(key) != expected.erase(key)) ++mismatches;
+	}
+	auto it = map.cbegin();
+	for (auto &p : expected) {
+		if (it == map.cend() || it->first != p.first) {
+			++mismatches;
+			break;
+		}
+		++it;
+	}
+	std::cout << map.size() << " " << mismatches << " " << filtered << std::endl;
+}
+
+void testTies() {
+	sjtu::map<Version, int, VersionLess> map;
+	for (int major = -3; major <= 3; ++major) {
+		for (int minor = 0; minor < 50; minor += 5) {
+			map[Version{major, minor}] = major * 100 + minor;
+		}
+	}
+	int mismatches = 0;
+	for (int major = -4; major <= 4; ++major) {
+		for (int minor = -1; minor < 52; ++minor) {
+			bool present = major >= -3 && major <= 3 && minor >= 0 && minor < 50 && minor % 5 == 0;
+			auto it = map.find(Version{major, minor});
+			if (present ? it == map.end() || it->second != major * 100 + minor : it != map.end()) {
+				++mismatches;
+			}
+		}
+	}
+	auto it = map.lower_bound(Version{1, 12});
+	std::cout << map.size() << " " << mismatches << " " << it->first.major << "." << it->first.minor << std::endl;
+}
+
+// Big integers of either sign, many sharing their top limbs so prefixes
+// tie, some with leading zeros (an extra limb) and some negative zero.
+Util::Bint randomBint() {
+	static const char *heads[] = {"", "12345678", "99990000", "7"};
+	std::string digits = heads[nextRand() % 4];
+	int length = nextRand() % 9 + (digits.empty() ? 1 : 0);
+	for (int i = 0; i < length; ++i) {
+		digits += char('0' + nextRand() % 10);
+	}
+	if (nextRand() % 8 == 0) digits = "0000" + digits;
+	return Util::Bint(nextRand() % 3 == 0 ? "-" + digits : digits);
+}
+
+void testBint() {
+	sjtu::map<Util::Bint, int, BintLess> map;
+	sjtu::map<Util::Bint, int, PlainBintLess> plain;
+	std::map<Util::Bint, int, PlainBintLess> expected;
+	std::vector<Util::Bint> queries;
+	for (int i = 0; i < 1500; ++i) {
+		Util::Bint key = randomBint();
+		map[key] = i;
+		plain[key] = i;
+		expected[key] = i;
+	}
+	for (int q = 0; q < 2000; ++q) {
+		queries.push_back(randomBint());
+	}
+	comparisons = 0;
+	for (auto &key : queries) plain.find(key);
+	long plainComparisons = comparisons;
+	comparisons = 0;
+	for (auto &key : queries) map.find(key);
+	bool filtered = comparisons < plainComparisons;
+	int mismatches = 0;
+	for (auto &key : queries) {
+		auto found = expected.find(key);
+		auto it = map.find(key);
+		if (found == expected.end() ? it != map.end() : it == map.end() || it->second != found->second) {
+			++mismatches;
+		}
+		auto lower = expected.lower_bound(key);
+		auto mine = map.lower_bound(key);
+		if (lower == expected.end() ? mine != map.end() : mine == map.end() || mine->second != lower->second) {
+			++mismatches;
+		}
+	}
+	auto it = map.cbegin();
+	for (auto &p : expected) {
+		if (it == map.cend() || it->first != p.first) {
+			++mismatches;
+			break;
+		}
+		++it;
+	}
+	std::cout << map.size() << " " << mismatches << " " << filtered << std::endl;
+}
+
+int main(void) {
+	testStrings();
+	testTies();
+	testBint();
+}
@@ -0,0 +1,89 @@
+#include "map.hpp"
+#include "arena_map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+long globalNews = 0;
+
+void *operator new(size_t size) {
+	++globalNews;
+	if (void *p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	std::free(p);
+}
+
+typedef sjtu::map<int, int> Map;
+typedef sjtu::arena_map<int, int> ArenaMap;
+
+static_assert(std::is_nothrow_move_constructible<Map>::value, "map move");
+static_assert(std::is_nothrow_move_assignable<Map>::value, "map move assignment");
+static_assert(noexcept(std::declval<Map&>().swap(std::declval<Map&>())), "map swap");
+static_assert(std::is_nothrow_move_constructible<ArenaMap>::value, "arena_map move");
+static_assert(std::is_nothrow_move_assignable<ArenaMap>::value, "arena_map move assignment");
+static_assert(noexcept(std::declval<ArenaMap&>().swap(std::declval<ArenaMap&>())), "arena_map swap");
+
+// Grows a vector of maps through several reallocations and checks that
+// every element stays where it was: the maps were moved, not copied.
+template<class M>
+void testVectorGrowth() {
+	std::vector<M> maps;
+	std::vector<const int*> addresses;
+	size_t reallocations = 0;
+	for (int m = 0; m < 100; ++m) {
+		size_t capacity = maps.capacity();
+		maps.push_back(M());
+		if (maps.capacity() != capacity) ++reallocations;
+		for (int i = 0; i < 50; ++i) {
+			maps.back()[i] = m * 100 + i;
+		}
+		addresses.push_back(&maps.back().at(25));
+	}
+	int moved = 0, wrong = 0;
+	for (int m = 0; m < 100; ++m) {
+		if (&maps[m].at(25) != addresses[m]) ++moved;
+		for (int i = 0; i < 50; ++i) {
+			if (maps[m].at(i) != m * 100 + i) ++wrong;
+		}
+		if (maps[m].size() != 50) ++wrong;
+	}
+	std::cout << (reallocations > 3) << " " << moved << " " << wrong << std::endl;
+}
+
+// Moving from a map allocates nothing, and leaves it empty and usable.
+template<class M>
+void testMovedFrom() {
+	M source;
+	for (int i = 0; i < 100; ++i) {
+		source[i] = i;
+	}
+	long news = globalNews;
+	M target(std::move(source));
+	M assigned;
+	assigned = std::move(target);
+	source.swap(target);
+	long moveNews = globalNews - news;
+	std::cout << moveNews << " " << source.size() << " " << target.size() << " " << assigned.size()
+	          << " " << (source.begin() == source.end()) << " " << source.count(5) << std::endl;
+	source[7] = 70;
+	target.insert(sjtu::pair<const int, int>(8, 80));
+	M copy(source);
+	copy = target;
+	std::cout << source.at(7) << " " << target.at(8) << " " << copy.size() << " " << copy.at(8) << std::endl;
+}
+
+int main(void) {
+	testVectorGrowth<Map>();
+	testVectorGrowth<ArenaMap>();
+	testMovedFrom<Map>();
+	testMovedFrom<ArenaMap>();
+}
@@ -0,0 +1,101 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+
+typedef sjtu::map<int, int, std::less<int>, std::allocator<sjtu::pair<const int, int> >,
+                  sjtu::order_statistics> Map;
+typedef std::map<int, int> Reference;
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+void testSmall() {
+	Map map;
+	for (int i = 0; i < 10; ++i) {
+		map[i * 3] = i;
+	}
+	std::cout << map.rank(-1) << " " << map.rank(0) << " " << map.rank(4) << " " << map.rank(27)
+	          << " " << map.rank(100) << std::endl;
+	for (size_t k = 0; k <= map.size(); ++k) {
+		Map::const_iterator it = static_cast<const Map&>(map).select(k);
+		if (it == map.cend()) {
+			std::cout << "end" << std::endl;
+		} else {
+			std::cout << it->first << " ";
+		}
+	}
+	std::cout << map.count_range(3, 12) << " " << map.count_range(4, 5) << " " << map.count_range(12, 3)
+	          << " " << map.count_range(-100, 100) << std::endl;
+
+	Map::iterator it = map.advance(map.begin(), 4);
+	std::cout << it->first << " " << map.advance(it, -2)->first << " "
+	          << (map.advance(it, 6) == map.end()) << " " << map.distance(map.cbegin(), it) << " "
+	          << map.distance(map.cend(), map.cbegin()) << std::endl;
+	try {
+		map.advance(it, 7);
+		std::cout << "no exception" << std::endl;
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "index_out_of_bound" << std::endl;
+	}
+	try {
+		map.advance(map.begin(), -1);
+		std::cout << "no exception" << std::endl;
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "index_out_of_bound" << std::endl;
+	}
+}
+
+void testRandom() {
+	// Sizes stay right through inserts, erases, range erases and split/join.
+	Map map;
+	Reference expected;
+	int range = 20000;
+	int mismatches = 0;
+	for (int round = 0; round < 20; ++round) {
+		for (int i = 0; i < 2000; ++i) {
+			int key = nextRand() % range;
+			if (nextRand() % 3) {
+				map[key] = i;
+				expected[key] = i;
+			} else {
+				map.erase(key);
+				expected.erase(key);
+			}
+		}
+		int lo = nextRand() % range, hi = lo + nextRand() % 200;
+		map.erase_range(lo, hi);
+		expected.erase(expected.lower_bound(lo), expected.lower_bound(hi));
+		int at = nextRand() % range;
+		Map upper = map.split(at);
+		map.join(upper);
+
+		for (int q = 0; q < 200; ++q) {
+			int key = nextRand() % range;
+			size_t rank = 0;
+			for (auto it = expected.begin(); it != expected.end() && it->first < key; ++it) ++rank;
+			if (map.rank(key) != rank) ++mismatches;
+			size_t k = nextRand() % (expected.size() + 1);
+			auto expectedAt = expected.begin();
+			for (size_t j = 0; j < k; ++j) ++expectedAt;
+			Map::iterator selected = map.select(k);
+			if (expectedAt == expected.end() ? selected != map.end() : selected->first != expectedAt->first) {
+				++mismatches;
+			}
+			if (map.distance(map.begin(), selected) != (std::ptrdiff_t)k) ++mismatches;
+			int hi = key + nextRand() % 3000;
+			size_t inRange = 0;
+			for (auto it = expected.lower_bound(key); it != expected.end() && it->first < hi; ++it) ++inRange;
+			if (map.count_range(key, hi) != inRange) ++mismatches;
+		}
+		std::cout << map.size() << " " << (map.size() == expected.size()) << " " << mismatches << std::endl;
+	}
+}
+
+int main(void) {
+	testSmall();
+	testRandom();
+}
@@ -0,0 +1,92 @@
+#include "map.hpp"
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+
+// Forwards to new/delete and keeps count of what is still allocated.
+class CountingResource : public std::pmr::memory_resource {
+public:
+	long outstanding = 0;
+
+private:
+	void *do_allocate(size_t bytes, size_t align) override {
+		outstanding += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, align);
+	}
+
+	void do_deallocate(void *p, size_t bytes, size_t align) override {
+		outstanding -= bytes;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+		return this == &other;
+	}
+};
+
+typedef sjtu::pmr::map<int, int> Map;
+
+long sum(const Map &map) {
+	long total = 0;
+	for (auto it = map.cbegin(); it != map.cend(); ++it) {
+		total += it->first * 3 + it->second;
+	}
+	return total;
+}
+
+void print(const char *name, const Map &map, const CountingResource &resource) {
+	std::cout << name << " " << map.size() << " " << sum(map) << " "
+	          << (map.get_allocator().resource() == &resource) << std::endl;
+}
+
+void tester(CountingResource &first, CountingResource &second) {
+	Map a(&first), b(&second), c(&first);
+	for (int i = 0; i < 1000; ++i) {
+		a[i] = i * 2;
+	}
+	for (int i = 0; i < 10; ++i) {
+		b[-i] = i;
+	}
+	c[7] = 7;
+
+	// Copy assignment keeps b's resource.
+	b = a;
+	print("copy", b, second);
+	a[1000] = 1;
+	std::cout << b.count(1000) << std::endl;
+
+	// Same resource: the nodes are taken over.
+	c = std::move(a);
+	print("move", c, first);
+	print("moved-from", a, first);
+
+	// Different resources: each element is moved across.
+	b = std::move(c);
+	print("move across", b, second);
+	print("moved-from", c, first);
+
+	Map d(&second);
+	d[5] = 5;
+	b.swap(d);
+	print("swap", b, second);
+	print("swap", d, second);
+	swap(b, d);
+	print("swap", b, second);
+
+	sjtu::pmr::map<int, std::unique_ptr<int> > e(&first), f(&second);
+	for (int i = 0; i < 100; ++i) {
+		e.emplace(i, std::unique_ptr<int>(new int(i * i)));
+	}
+	f = std::move(e);
+	long total = 0;
+	for (auto it = f.begin(); it != f.end(); ++it) {
+		total += *it->second;
+	}
+	std::cout << "move-only " << f.size() << " " << e.size() << " " << total << std::endl;
+}
+
+int main(void) {
+	CountingResource first, second;
+	tester(first, second);
+	std::cout << first.outstanding << " " << second.outstanding << std::endl;
+}
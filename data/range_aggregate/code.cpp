@@ -0,0 +1,110 @@
+#include "map.hpp"
+#include <iostream>
+#include <limits>
+#include <map>
+#include <type_traits>
+
+template<class Monoid>
+using Map = sjtu::map<int, int, std::less<int>, std::allocator<sjtu::pair<const int, int> >,
+                      sjtu::range_aggregate<Monoid> >;
+
+typedef Map<sjtu::sum_of<long long> > SumMap;
+typedef Map<sjtu::min_of<int> > MinMap;
+typedef Map<sjtu::max_of<int> > MaxMap;
+typedef Map<sjtu::count_of> CountMap;
+
+// Mapped values of a tracked map are only reachable as const.
+static_assert(std::is_same<decltype(std::declval<SumMap&>().at(0)), const int&>::value, "at");
+static_assert(std::is_same<decltype(std::declval<SumMap&>()[0]), const int&>::value, "operator[]");
+static_assert(std::is_same<decltype(*std::declval<SumMap::iterator&>()),
+                           const sjtu::pair<const int, int>&>::value, "iterator");
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+void testSmall() {
+	SumMap sum;
+	MinMap min;
+	MaxMap max;
+	CountMap count;
+	for (int i = 1; i <= 10; ++i) {
+		sum.insert_or_assign(i, i * i);
+		min.insert_or_assign(i, i * i);
+		max.insert_or_assign(i, i * i);
+		count.insert_or_assign(i, i * i);
+	}
+	std::cout << sum.aggregate() << " " << sum.aggregate(3, 6) << " " << sum.aggregate(6, 3) << " "
+	          << sum.aggregate(11, 20) << std::endl;
+	std::cout << min.aggregate(4, 8) << " " << max.aggregate(4, 8) << " " << count.aggregate(4, 8) << " "
+	          << count.aggregate() << std::endl;
+
+	std::cout << sum.update(5, [](int &value) { value = -100; }) << " "
+	          << sum.update(50, [](int &value) { value = 1; }) << " " << sum.aggregate(3, 6) << std::endl;
+	sum.update(sum.find(3), [](int &value) { value += 1; });
+	sum.insert_or_assign(4, 0);
+	std::cout << sum.aggregate(3, 6) << " " << sum.at(5) << " " << sum[4] << std::endl;
+	try {
+		sum.update(10, [](int &value) {
+			value = 1000;
+			throw 1;
+		});
+	} catch (int) {
+	}
+	std::cout << sum.at(10) << " " << sum.aggregate(10, 11) << std::endl;
+	sum.erase(10);
+	std::cout << sum.aggregate() << " " << sum.aggregate(9, 100) << std::endl;
+}
+
+void testRandom() {
+	SumMap sum;
+	MinMap min;
+	std::map<int, int> expected;
+	int range = 5000, mismatches = 0;
+	for (int round = 0; round < 10; ++round) {
+		for (int i = 0; i < 3000; ++i) {
+			int key = nextRand() % range, value = nextRand() - 16384;
+			int kind = nextRand() % 4;
+			if (kind == 0) {
+				sum.erase(key);
+				min.erase(key);
+				expected.erase(key);
+			} else if (kind == 1 && expected.count(key)) {
+				sum.update(key, [&](int &v) { v += value; });
+				min.update(key, [&](int &v) { v += value; });
+				expected[key] += value;
+			} else {
+				sum.insert_or_assign(key, value);
+				min.insert_or_assign(key, value);
+				expected[key] = value;
+			}
+		}
+		int lo = nextRand() % range, hi = lo + nextRand() % 300;
+		sum.erase_range(lo, hi);
+		min.erase_range(lo, hi);
+		expected.erase(expected.lower_bound(lo), expected.lower_bound(hi));
+		SumMap upper = sum.split(nextRand() % range);
+		sum.join(upper);
+
+		for (int q = 0; q < 300; ++q) {
+			int lo = nextRand() % range, hi = lo + nextRand() % 2000;
+			long long total = 0;
+			int least = std::numeric_limits<int>::max();
+			for (auto it = expected.lower_bound(lo); it != expected.end() && it->first < hi; ++it) {
+				total += it->second;
+				least = it->second < least ? it->second : least;
+			}
+			if (sum.aggregate(lo, hi) != total) ++mismatches;
+			if (min.aggregate(lo, hi) != least) ++mismatches;
+		}
+		std::cout << sum.size() << " " << sum.aggregate() << " " << mismatches << std::endl;
+	}
+}
+
+int main(void) {
+	testSmall();
+	testRandom();
+}
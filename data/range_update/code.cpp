@@ -0,0 +1,132 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+
+typedef sjtu::affine<long long> Affine;
+typedef sjtu::map<int, long long, std::less<int>, std::allocator<sjtu::pair<const int, long long> >,
+                  sjtu::range_update<Affine> > Map;
+typedef std::map<int, long long> Reference;
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+void print(const Map &map) {
+	for (auto it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << ":" << it->second << " ";
+	}
+	std::cout << map.size() << std::endl;
+}
+
+bool same(const Map &map, const Reference &expected) {
+	if (map.size() != expected.size()) return false;
+	auto it = map.cbegin();
+	for (auto &p : expected) {
+		if (it->first != p.first || it->second != p.second) return false;
+		++it;
+	}
+	return it == map.cend();
+}
+
+void apply(Reference &map, int lo, int hi, const Affine::op_type &op) {
+	for (auto it = map.lower_bound(lo); it != map.end() && it->first < hi; ++it) {
+		it->second = it->second * op.mul + op.add;
+	}
+}
+
+Affine::op_type randomOp() {
+	int kind = nextRand() % 3;
+	long long value = nextRand() % 7 - 3;
+	return kind == 0 ? Affine::add(value) : kind == 1 ? Affine::scale(value) : Affine::assign(value);
+}
+
+void testSmall() {
+	Map map;
+	for (int i = 0; i < 10; ++i) {
+		map.insert_or_assign(i, (long long)i);
+	}
+	map.range_apply(2, 8, Affine::add(10));
+	print(map);
+	map.range_apply(0, 5, Affine::scale(2));
+	map.range_apply(4, 6, Affine::assign(-1));
+	map.range_apply(7, 3, Affine::assign(100));
+	print(map);
+	std::cout << map.at(3) << " " << map.find(7)->second << " " << map.count(4) << std::endl;
+
+	// Ops reach elements inserted before them, not after.
+	map.range_apply(0, 100, Affine::add(1));
+	map.insert_or_assign(20, 0LL);
+	map.update(9, [](long long &value) { value *= 3; });
+	print(map);
+	Map copy = map;
+	map.range_apply(0, 100, Affine::scale(0));
+	print(copy);
+	print(map);
+}
+
+void testRandom() {
+	Map map;
+	Reference expected;
+	int range = 3000;
+	for (int round = 0; round < 12; ++round) {
+		for (int i = 0; i < 1000; ++i) {
+			int key = nextRand() % range;
+			int kind = nextRand() % 5;
+			if (kind == 0) {
+				map.erase(key);
+				expected.erase(key);
+			} else if (kind == 1) {
+				int hi = key + nextRand() % 500;
+				Affine::op_type op = randomOp();
+				map.range_apply(key, hi, op);
+				apply(expected, key, hi, op);
+			} else if (kind == 2 && expected.count(key)) {
+				map.update(key, [](long long &value) { value += 5; });
+				expected[key] += 5;
+			} else {
+				map.insert_or_assign(key, (long long)i);
+				expected[key] = i;
+			}
+		}
+		switch (round % 4) {
+		case 0: {
+			int at = nextRand() % range;
+			Map upper = map.split(at);
+			upper.range_apply(0, range, Affine::add(7));
+			map.join(upper);
+			apply(expected, at, range, Affine::add(7));
+			break;
+		}
+		case 1: {
+			int lo = nextRand() % range, hi = lo + nextRand() % 200;
+			map.erase_range(lo, hi);
+			expected.erase(expected.lower_bound(lo), expected.lower_bound(hi));
+			break;
+		}
+		case 2: {
+			Map other;
+			for (int i = 0; i < 200; ++i) {
+				other.insert_or_assign(nextRand() % range, 1LL);
+			}
+			other.range_apply(0, range / 2, Affine::add(4));
+			for (auto it = other.cbegin(); it != other.cend(); ++it) {
+				expected.insert(std::make_pair(it->first, it->second));
+			}
+			map.merge_union(other);
+			break;
+		}
+		default:
+			map.range_apply(0, range, Affine::scale(-1));
+			apply(expected, 0, range, Affine::scale(-1));
+		}
+		std::cout << map.size() << " " << same(map, expected) << std::endl;
+	}
+}
+
+int main(void) {
+	testSmall();
+	testRandom();
+}
@@ -0,0 +1,332 @@
+#include "map.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+typedef sjtu::map<int, int> Map;
+typedef std::map<int, int> Reference;
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+void print(const Map &map) {
+	for (auto it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first << ":" << it->second << " ";
+	}
+	std::cout << map.size() << std::endl;
+}
+
+bool same(const Map &map, const Reference &expected) {
+	if (map.size() != expected.size()) return false;
+	auto it = map.cbegin();
+	for (auto &p : expected) {
+		if (it->first != p.first || it->second != p.second) return false;
+		++it;
+	}
+	return it == map.cend();
+}
+
+Map range(int first, int last, int step) {
+	Map map;
+	for (int i = first; i < last; i += step) {
+		map[i] = i * 10;
+	}
+	return map;
+}
+
+void testSplitJoin() {
+	Map map = range(0, 20, 2);
+	Map upper = map.split(7);
+	print(map);
+	print(upper);
+	Map top = upper.split(100);
+	print(upper);
+	print(top);
+	Map all = map.split(-5);
+	print(map);
+	print(all);
+
+	// Either order works; overlapping key ranges throw and change nothing.
+	map = range(100, 104, 1);
+	all.join(map);
+	print(all);
+	print(map);
+	map = range(-6, -2, 2);
+	all.join(map);
+	print(all);
+	map = range(5, 7, 1);
+	try {
+		all.join(map);
+		std::cout << "no exception" << std::endl;
+	} catch (sjtu::runtime_error &) {
+		std::cout << "runtime_error" << std::endl;
+	}
+	print(all);
+	print(map);
+	map.join(Map());
+	Map empty;
+	empty.join(map);
+	print(empty);
+	print(map);
+}
+
+void testSetOps() {
+	Map a = range(0, 10, 1), b = range(5, 15, 1);
+	for (auto it = b.begin(); it != b.end(); ++it) it->second = 1;
+
+	Map u = a;
+	u.merge_union(b);
+	print(u);
+	u = a;
+	u.merge_union(b, [](int &mine, const int &theirs) { mine += theirs; });
+	print(u);
+	u = a;
+	Map moved = b;
+	u.merge_union(std::move(moved));
+	print(u);
+	print(moved);
+
+	Map i = a;
+	i.intersection(b);
+	print(i);
+	i = a;
+	i.intersection(b, [](int &mine, const int &theirs) { mine = mine * 100 + theirs; });
+	print(i);
+
+	Map d = a;
+	d.difference(b);
+	print(d);
+	d.difference(d);
+	print(d);
+}
+
+void testRandom() {
+	// Sizes both close and far apart, for the join-based and the per-key
+	// paths.
+	int sizes[][2] = {{0, 100}, {100, 0}, {2000, 2000}, {5000, 20}, {20, 5000}, {3000, 800}};
+	for (auto &size : sizes) {
+		Map a, b;
+		Reference ra, rb;
+		int range = (size[0] + size[1]) * 2 + 10;
+		for (int i = 0; i < size[0]; ++i) {
+			int key = nextRand() % range, value = nextRand();
+			a[key] = value;
+			ra[key] = value;
+		}
+		for (int i = 0; i < size[1]; ++i) {
+			int key = nextRand() % range, value = nextRand();
+			b[key] = value;
+			rb[key] = value;
+		}
+
+		Map u = a;
+		u.merge_union(b, [](int &mine, const int &theirs) { mine ^= theirs; });
+		Reference ru = ra;
+		for (auto &p : rb) {
+			auto it = ru.find(p.first);
+			if (it == ru.end()) ru.insert(p); else it->second ^= p.second;
+		}
+
+		Map i = a;
+		i.intersection(b, [](int &mine, const int &theirs) { mine -= theirs; });
+		Reference ri;
+		for (auto &p : ra) {
+			if (rb.count(p.first)) ri[p.first] = p.second - rb[p.first];
+		}
+
+		Map d = a;
+		d.difference(b);
+		Reference rd = ra;
+		for (auto &p : rb) rd.erase(p.first);
+
+		int key = nextRand() % range;
+		Map lower = a, upper = lower.split(key);
+		Reference rl(ra.begin(), ra.lower_bound(key)), rr(ra.lower_bound(key), ra.end());
+		bool splitOk = same(lower, rl) && same(upper, rr);
+		lower.join(upper);
+
+		std::cout << u.size() << " " << same(u, ru) << " " << i.size() << " " << same(i, ri) << " "
+		          << d.size() << " " << same(d, rd) << " " << splitOk << " " << same(lower, ra) << std::endl;
+	}
+}
+
+typedef sjtu::map<std::string, int> StringMap;
+typedef std::map<std::string, int> StringReference;
+
+bool sameStrings(const StringMap &map, const StringReference &expected) {
+	if (map.size() != expected.size()) return false;
+	auto it = map.cbegin();
+	for (auto &p : expected) {
+		if (it->first != p.first || it->second != p.second) return false;
+		++it;
+	}
+	return it == map.cend();
+}
+
+// String keys walk the larger side with a finger instead of from the root.
+void testRandomStrings() {
+	int sizes[][2] = {{3000, 300}, {300, 3000}, {2000, 1500}, {4000, 40}};
+	for (auto &size : sizes) {
+		StringMap a, b;
+		StringReference ra, rb;
+		int range = (size[0] + size[1]) * 2 + 10;
+		for (int i = 0; i < size[0]; ++i) {
+			std::string key = std::to_string(nextRand() % range);
+			int value = nextRand();
+			a[key] = value;
+			ra[key] = value;
+		}
+		for (int i = 0; i < size[1]; ++i) {
+			std::string key = std::to_string(nextRand() % range);
+			int value = nextRand();
+			b[key] = value;
+			rb[key] = value;
+		}
+
+		StringMap u = a;
+		u.merge_union(b, [](int &mine, const int &theirs) { mine ^= theirs; });
+		StringReference ru = ra;
+		for (auto &p : rb) {
+			auto it = ru.find(p.first);
+			if (it == ru.end()) ru.insert(p); else it->second ^= p.second;
+		}
+
+		StringMap i = a;
+		i.intersection(b, [](int &mine, const int &theirs) { mine -= theirs; });
+		StringReference ri;
+		for (auto &p : ra) {
+			if (rb.count(p.first)) ri[p.first] = p.second - rb[p.first];
+		}
+
+		StringMap d = a;
+		d.difference(b);
+		StringReference rd = ra;
+		for (auto &p : rb) rd.erase(p.first);
+
+		std::cout << u.size() << " " << sameStrings(u, ru) << " " << i.size() << " " << sameStrings(i, ri) << " "
+		          << d.size() << " " << sameStrings(d, rd) << std::endl;
+	}
+}
+
+long liveBytes = 0;
+
+// Takes memory from malloc and keeps count of what is outstanding.
+template<class T>
+struct CountingAllocator {
+	typedef T value_type;
+
+	CountingAllocator() {}
+
+	template<class U>
+	CountingAllocator(const CountingAllocator<U> &) {}
+
+	T *allocate(size_t n) {
+		liveBytes += n * sizeof(T);
+		return static_cast<T*>(std::malloc(n * sizeof(T)));
+	}
+
+	void deallocate(T *p, size_t n) {
+		liveBytes -= n * sizeof(T);
+		std::free(p);
+	}
+
+	template<class U>
+	bool operator == (const CountingAllocator<U> &) const {
+		return true;
+	}
+
+	template<class U>
+	bool operator != (const CountingAllocator<U> &) const {
+		return false;
+	}
+};
+
+// A sliding window: add a round of keys, split off the oldest and drop
+// them. Whichever side is dropped, its memory must come back, so the
+// footprint stops growing once the window is full.
+void testFootprint() {
+	typedef sjtu::map<int, int, std::less<int>, CountingAllocator<sjtu::pair<const int, int> > > Counted;
+	Counted window;
+	int next = 0;
+	long settled = 0;
+	bool flat = true;
+	for (int round = 0; round < 100; ++round) {
+		for (int i = 0; i < 2000; ++i) {
+			window[next++] = i;
+		}
+		Counted newest = window.split(next - 10000);
+		if (round % 2) {
+			window = std::move(newest);
+		} else {
+			window.swap(newest);
+		}
+		if (round == 20) settled = liveBytes;
+		if (round > 20 && liveBytes > settled) flat = false;
+	}
+	std::cout << window.size() << " " << window.begin()->first << " " << flat << std::endl;
+
+	// The same with the older side the larger one.
+	Counted older;
+	for (int round = 0; round < 100; ++round) {
+		for (int i = 0; i < 2000; ++i) {
+			older[next++] = i;
+		}
+		Counted newest = older.split(next - 1000);
+		older.clear();
+		older.swap(newest);
+		if (round == 20) settled = liveBytes;
+		if (round > 20 && liveBytes > settled) flat = false;
+	}
+	std::cout << older.size() << " " << flat << std::endl;
+}
+
+// Copies of this throw once the budget runs out, and it has no move.
+class Fragile {
+public:
+	static int budget;
+	int value;
+
+	Fragile(int value) : value(value) {}
+
+	Fragile(const Fragile &rhs) : value(rhs.value) {
+		if (budget-- == 0) throw std::string("copy failed");
+	}
+};
+
+int Fragile::budget = -1;
+
+// If an element cannot be moved across, split() leaves the map whole.
+void testSplitThrows() {
+	sjtu::map<int, Fragile> map;
+	for (int i = 0; i < 100; ++i) {
+		map.insert(sjtu::pair<const int, Fragile>(i, Fragile(i * 10)));
+	}
+	Fragile::budget = 20;
+	try {
+		map.split(70);
+		std::cout << "no exception" << std::endl;
+	} catch (std::string &error) {
+		std::cout << error << std::endl;
+	}
+	Fragile::budget = -1;
+	int wrong = 0, key = 0;
+	for (auto it = map.cbegin(); it != map.cend(); ++it, ++key) {
+		if (it->first != key || it->second.value != key * 10) ++wrong;
+	}
+	auto upper = map.split(70);
+	std::cout << map.size() << " " << upper.size() << " " << wrong << " " << upper.cbegin()->second.value << std::endl;
+}
+
+int main(void) {
+	testSplitJoin();
+	testSetOps();
+	testRandom();
+	testRandomStrings();
+	testFootprint();
+	testSplitThrows();
+}
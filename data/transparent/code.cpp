@@ -0,0 +1,106 @@
+#include "map.hpp"
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// A key that counts how many times it is built.
+class Name {
+public:
+	static int made;
+	std::string text;
+
+	Name(const char *text) : text(text) {
+		made++;
+	}
+
+	Name(const Name &rhs) : text(rhs.text) {
+		made++;
+	}
+};
+
+int Name::made = 0;
+
+class Less {
+public:
+	bool operator () (const Name &lhs, const Name &rhs) const {
+		return lhs.text < rhs.text;
+	}
+};
+
+// Also compares names with C strings, and says so.
+class TransparentLess {
+public:
+	typedef void is_transparent;
+
+	bool operator () (const Name &lhs, const Name &rhs) const {
+		return lhs.text < rhs.text;
+	}
+
+	bool operator () (const Name &lhs, const char *rhs) const {
+		return std::strcmp(lhs.text.c_str(), rhs) < 0;
+	}
+
+	bool operator () (const char *lhs, const Name &rhs) const {
+		return std::strcmp(lhs, rhs.text.c_str()) < 0;
+	}
+
+	bool operator () (const char *lhs, const char *rhs) const {
+		return std::strcmp(lhs, rhs) < 0;
+	}
+};
+
+const char *words[] = {"apple", "banana", "cherry", "date", "elder", "fig", "grape"};
+
+template<class Map>
+void fill(Map &map) {
+	for (int i = 0; i < 7; ++i) {
+		map.insert(sjtu::pair<const Name, int>(Name(words[i]), i));
+	}
+}
+
+template<class Iterator>
+std::string show(const Iterator &it, const Iterator &end) {
+	return it == end ? std::string("end") : it->first.text;
+}
+
+void testTransparent() {
+	typedef sjtu::map<Name, int, TransparentLess, std::allocator<sjtu::pair<const Name, int> >,
+	                  sjtu::order_statistics> Map;
+	Map map;
+	fill(map);
+	const Map &constant = map;
+	int before = Name::made;
+
+	std::cout << map.find("cherry")->second << " " << (map.find("coconut") == map.end()) << " "
+	          << constant.find("fig")->second << " " << map.count("date") << " " << map.count("kiwi") << " "
+	          << map.at("grape") << " " << constant.at("apple") << std::endl;
+	try {
+		map.at("kiwi");
+		std::cout << "no exception" << std::endl;
+	} catch (sjtu::index_out_of_bound &) {
+		std::cout << "index_out_of_bound" << std::endl;
+	}
+	auto range = map.equal_range("banana");
+	std::cout << show(map.lower_bound("c"), map.end()) << " " << show(map.upper_bound("date"), map.end()) << " "
+	          << show(range.first, map.end()) << "-" << show(range.second, map.end()) << " "
+	          << show(map.floor("dog"), map.end()) << " " << show(constant.ceiling("dog"), constant.cend()) << " "
+	          << map.rank("d") << " " << map.count_range("b", "e") << std::endl;
+	std::cout << map.erase("banana") << " " << map.erase("banana") << " " << map.erase_range("c", "e") << " "
+	          << map.size() << std::endl;
+	std::cout << "keys built by lookups: " << Name::made - before << std::endl;
+}
+
+void testConverting() {
+	// Without is_transparent, a C string still converts to one Name per call.
+	sjtu::map<Name, int, Less> map;
+	fill(map);
+	int before = Name::made;
+	std::cout << map.find("cherry")->second << " " << map.count("kiwi") << " " << map.erase("fig") << " "
+	          << map.size() << std::endl;
+	std::cout << "keys built by lookups: " << Name::made - before << std::endl;
+}
+
+int main(void) {
+	testTransparent();
+	testConverting();
+}
@@ -0,0 +1,120 @@
+#include "map.hpp"
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+unsigned seed = 1;
+
+int nextRand() {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+typedef sjtu::map<std::string, std::string> Map;
+
+void testReturns() {
+	Map map;
+	auto first = map.try_emplace("b", 3, 'x');
+	std::cout << first.second << " " << first.first->first << " " << first.first->second << std::endl;
+
+	// try_emplace leaves an existing value and its arguments alone.
+	std::string value = "other";
+	auto again = map.try_emplace("b", std::move(value));
+	std::cout << again.second << " " << (again.first == first.first) << " " << again.first->second << " "
+	          << value << std::endl;
+
+	// So does an rvalue key that is already present.
+	std::string key = "b";
+	map.try_emplace(std::move(key), "ignored");
+	std::cout << key << " " << map.at("b") << std::endl;
+
+	// insert_or_assign overwrites in place.
+	auto assigned = map.insert_or_assign("b", std::string("yyy"));
+	std::cout << assigned.second << " " << (assigned.first == first.first) << " " << map.at("b") << std::endl;
+	auto inserted = map.insert_or_assign("a", "zz");
+	std::cout << inserted.second << " " << inserted.first->first << " " << inserted.first->second << " "
+	          << (map.begin() == inserted.first) << " " << map.size() << std::endl;
+
+	// insert() and operator[] report the same way.
+	auto plain = map.insert(sjtu::pair<const std::string, std::string>("a", "no"));
+	std::cout << plain.second << " " << plain.first->second << " " << map["c"].size() << " " << map.size()
+	          << std::endl;
+}
+
+// Iterators and references stay valid while other keys come and go.
+void testValidity() {
+	Map map;
+	std::vector<Map::iterator> kept;
+	std::vector<const std::string*> addresses;
+	for (int i = 0; i < 100; ++i) {
+		auto result = map.try_emplace(std::to_string(i * 10), std::to_string(i));
+		kept.push_back(result.first);
+		addresses.push_back(&result.first->second);
+	}
+	for (int i = 0; i < 5000; ++i) {
+		std::string key = std::to_string(nextRand() % 1000);
+		if (key.back() == '0') continue;
+		if (nextRand() % 2) {
+			map.insert_or_assign(key, std::string("x"));
+		} else {
+			map.try_emplace(key, "y");
+		}
+		if (nextRand() % 3 == 0) map.erase(key);
+	}
+	for (int i = 0; i < 100; i += 2) {
+		map.insert_or_assign(std::to_string(i * 10), std::to_string(-i));
+	}
+	int wrong = 0;
+	for (int i = 0; i < 100; ++i) {
+		std::string expected = std::to_string(i % 2 ? i : -i);
+		if (kept[i]->second != expected || &kept[i]->second != addresses[i]) ++wrong;
+		if (map.find(std::to_string(i * 10)) != kept[i]) ++wrong;
+	}
+	std::cout << wrong << std::endl;
+}
+
+void testRandom() {
+	sjtu::map<int, int> map;
+	std::map<int, int> expected;
+	int mismatches = 0, inserted = 0;
+	for (int i = 0; i < 100000; ++i) {
+		int key = nextRand() % 5000, value = nextRand();
+		switch (nextRand() % 4) {
+			case 0: {
+				auto got = map.try_emplace(key, value);
+				auto want = expected.emplace(key, value);
+				if (got.second != want.second || got.first->second != want.first->second) ++mismatches;
+				inserted += got.second;
+				break;
+			}
+			case 1: {
+				auto got = map.insert_or_assign(key, value);
+				bool fresh = expected.count(key) == 0;
+				expected[key] = value;
+				if (got.second != fresh || got.first->second != value) ++mismatches;
+				break;
+			}
+			case 2:
+				if (map[key] != expected[key]) ++mismatches;
+				break;
+			default:
+				if (map.erase(key) != expected.erase(key)) ++mismatches;
+		}
+	}
+	auto it = map.begin();
+	for (auto &p : expected) {
+		if (it == map.end() || it->first != p.first || it->second != p.second) {
+			++mismatches;
+			break;
+		}
+		++it;
+	}
+	std::cout << map.size() << " " << inserted << " " << mismatches << std::endl;
+}
+
+int main(void) {
+	testReturns();
+	testValidity();
+	testRandom();
+}
@@ -0,0 +1,1064 @@
+/**
+* a map whose nodes live in one contiguous arena and link to each other
+* through 32-bit indices instead of pointers
+*/
+#ifndef SJTU_ARENA_MAP_HPP
+#define SJTU_ARENA_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include "map.hpp"
+
+namespace sjtu {
+
+// The AVL engine of sjtu::map over index links, for maps below 4G
+// elements. Slot 0 of the arena is the header (end()); a slot's links are
+// indices, so the arena grows by relocation, and for trivially copyable
+// elements the whole arena is moved with memcpy. Unlike sjtu::map, growth
+// moves every element: an insertion may invalidate all references and
+// pointers to elements, including those from operator[], at(), * and ->.
+// Iterators hold indices and stay valid.
+template<
+   class Key,
+   class T,
+   class Compare = std::less <Key>,
+   class Allocator = std::allocator<pair<const Key, T> >
+   > class arena_map : private detail::ebo_storage<Compare> {
+  public:
+   typedef pair<const Key, T> value_type;
+   typedef Allocator allocator_type;
+
+  private:
+   typedef std::uint32_t index_type;
+
+   static constexpr index_type nil = 0xffffffffu;
+   static constexpr index_type headerIndex = 0;
+   static constexpr signed char freeMark = 2;
+
+   // balance is height(right) - height(left); free slots are marked with
+   // freeMark and chained through `left`.
+   struct Node {
+       index_type left, right, parent;
+       signed char balance;
+       union {
+           value_type data;
+       };
+
+       Node() : left(nil), right(nil), parent(nil), balance(0) {}
+       ~Node() {}
+   };
+
+   typedef std::allocator_traits<Allocator> AllocTraits;
+   typedef typename AllocTraits::template rebind_alloc<Node> NodeAllocator;
+   typedef typename AllocTraits::template rebind_traits<Node> NodeTraits;
+
+   // The slot array together with the allocator it came from.
+   struct Arena : detail::ebo_storage<Allocator> {
+       Node *nodes;
+       index_type capacity, used, freeList;
+
+       explicit Arena(const Allocator &a)
+           : detail::ebo_storage<Allocator>(a),
+             nodes(nullptr), capacity(0), used(0), freeList(nil) {}
+
+       Allocator &allocator() {
+           return this->get();
+       }
+
+       const Allocator &allocator() const {
+           return this->get();
+       }
+   };
+
+   Arena arena;
+   index_type leftmost, rightmost;
+   size_t mapSize;
+
+   const Compare &comp() const {
+       return this->get();
+   }
+
+   Node &node(index_type i) const {
+       return arena.nodes[i];
+   }
+
+   const Key &keyOf(index_type i) const {
+       return arena.nodes[i].data.first;
+   }
+
+   // A map that never held an element has no arena at all, so that
+   // constructing and moving from it never allocate.
+   index_type root() const {
+       return arena.nodes ? arena.nodes[headerIndex].left : nil;
+   }
+
+   static constexpr size_t minCapacity = 16;
+
+   size_t grownCapacity() const {
+       size_t newCapacity = arena.capacity ? size_t(arena.capacity) * 2 : minCapacity;
+       if (newCapacity > size_t(nil)) newCapacity = nil;
+       if (newCapacity <= arena.capacity) throw runtime_error();
+       return newCapacity;
+   }
+
+   // Moves every slot into `fresh`, an array of `newCapacity` slots, and
+   // frees the old one. All slots below `used` are live when this runs,
+   // since free slots are reused first. On failure `fresh` is left empty
+   // and the arena as it was.
+   void relocate(Node *fresh, size_t newCapacity) {
+       NodeAllocator nodeAlloc(arena.allocator());
+       Node *old = arena.nodes;
+       if (std::is_trivially_copyable<value_type>::value) {
+           if (old) std::memcpy(static_cast<void*>(fresh), old, sizeof(Node) * arena.used);
+       } else {
+           index_type i = 0;
+           try {
+               for (; i < arena.used; ++i) {
+                   Node *slot = ::new (fresh + i) Node;
+                   slot->left = old[i].left;
+                   slot->right = old[i].right;
+                   slot->parent = old[i].parent;
+                   slot->balance = old[i].balance;
+                   if (i != headerIndex) {
+                       AllocTraits::construct(arena.allocator(), &slot->data, std::move(old[i].data));
+                   }
+               }
+           } catch (...) {
+               while (i-- > 1) AllocTraits::destroy(arena.allocator(), &fresh[i].data);
+               throw;
+           }
+           for (i = 1; i < arena.used; ++i) {
+               AllocTraits::destroy(arena.allocator(), &old[i].data);
+           }
+       }
+       if (old) NodeTraits::deallocate(nodeAlloc, old, arena.capacity);
+       arena.nodes = fresh;
+       arena.capacity = index_type(newCapacity);
+   }
+
+   void grow() {
+       size_t newCapacity = grownCapacity();
+       NodeAllocator nodeAlloc(arena.allocator());
+       Node *fresh = NodeTraits::allocate(nodeAlloc, newCapacity);
+       try {
+           relocate(fresh, newCapacity);
+       } catch (...) {
+           NodeTraits::deallocate(nodeAlloc, fresh, newCapacity);
+           throw;
+       }
+   }
+
+   // Empties the map, keeping the arena, if any, with just the header.
+   // Never allocates.
+   void resetArena() noexcept {
+       arena.freeList = nil;
+       leftmost = rightmost = headerIndex;
+       mapSize = 0;
+       if (!arena.nodes) {
+           arena.used = 0;
+           return;
+       }
+       arena.used = 1;
+       Node *h = ::new (arena.nodes) Node;
+       h->left = h->right = h->parent = nil;
+   }
+
+   // Gives a map without an arena its first one.
+   void ensureArena() {
+       if (!arena.nodes) {
+           grow();
+           resetArena();
+       }
+   }
+
+   template<class... Args>
+   index_type createNode(Args&&... args) {
+       ensureArena();
+       index_type i;
+       if (arena.freeList != nil) {
+           i = arena.freeList;
+           arena.freeList = arena.nodes[i].left;
+       } else if (arena.used == arena.capacity) {
+           return createGrown(std::forward<Args>(args)...);
+       } else {
+           i = arena.used++;
+       }
+       Node *slot = ::new (arena.nodes + i) Node;
+       try {
+           AllocTraits::construct(arena.allocator(), &slot->data, std::forward<Args>(args)...);
+       } catch (...) {
+           dropSlot(i);
+           throw;
+       }
+       return i;
+   }
+
+   // createNode() on a full arena. The element is built in the new array
+   // before the old one is freed, so arguments that refer to elements of
+   // this map, as in m.try_emplace(k, m.at(j)), are still alive when read.
+   template<class... Args>
+   index_type createGrown(Args&&... args) {
+       size_t newCapacity = grownCapacity();
+       NodeAllocator nodeAlloc(arena.allocator());
+       Node *fresh = NodeTraits::allocate(nodeAlloc, newCapacity);
+       index_type i = arena.used;
+       Node *slot = ::new (fresh + i) Node;
+       try {
+           AllocTraits::construct(arena.allocator(), &slot->data, std::forward<Args>(args)...);
+       } catch (...) {
+           NodeTraits::deallocate(nodeAlloc, fresh, newCapacity);
+           throw;
+       }
+       try {
+           relocate(fresh, newCapacity);
+       } catch (...) {
+           AllocTraits::destroy(arena.allocator(), &slot->data);
+           NodeTraits::deallocate(nodeAlloc, fresh, newCapacity);
+           throw;
+       }
+       arena.used = i + 1;
+       return i;
+   }
+
+   void dropSlot(index_type i) {
+       Node &n = arena.nodes[i];
+       n.balance = freeMark;
+       n.left = arena.freeList;
+       arena.freeList = i;
+   }
+
+   void dropNode(index_type i) {
+       AllocTraits::destroy(arena.allocator(), &arena.nodes[i].data);
+       dropSlot(i);
+   }
+
+   void destroyAll() {
+       if (!std::is_trivially_destructible<value_type>::value) {
+           for (index_type i = 1; i < arena.used; ++i) {
+               if (arena.nodes[i].balance != freeMark) {
+                   AllocTraits::destroy(arena.allocator(), &arena.nodes[i].data);
+               }
+           }
+       }
+   }
+
+   void releaseArena() {
+       destroyAll();
+       if (arena.nodes) {
+           NodeAllocator nodeAlloc(arena.allocator());
+           NodeTraits::deallocate(nodeAlloc, arena.nodes, arena.capacity);
+       }
+       arena.nodes = nullptr;
+       arena.capacity = arena.used = 0;
+       arena.freeList = nil;
+   }
+
+   static const value_type &elementOf(Node &slot, std::false_type) {
+       return slot.data;
+   }
+
+   static value_type &&elementOf(Node &slot, std::true_type) {
+       return std::move(slot.data);
+   }
+
+   // Copies slot by slot, so the copy has exactly the same indices. With
+   // std::true_type the elements are moved out of `other`, which the
+   // caller then clears.
+   template<class Move = std::false_type>
+   void copyArena(const arena_map &other, Move move = Move()) {
+       if (!other.arena.nodes) return;
+       ensureArena();
+       while (arena.capacity < other.arena.used) grow();
+       index_type i = 1;
+       try {
+           for (; i < other.arena.used; ++i) {
+               Node &src = other.arena.nodes[i];
+               Node *slot = ::new (arena.nodes + i) Node;
+               if (src.balance != freeMark) {
+                   AllocTraits::construct(arena.allocator(), &slot->data, elementOf(src, move));
+               }
+               slot->left = src.left;
+               slot->right = src.right;
+               slot->parent = src.parent;
+               slot->balance = src.balance;
+           }
+       } catch (...) {
+           arena.used = i;
+           arena.freeList = nil;
+           for (index_type j = 1; j < i; ++j) {
+               if (arena.nodes[j].balance == freeMark) {
+                   arena.nodes[j].left = arena.freeList;
+                   arena.freeList = j;
+               }
+           }
+           throw;
+       }
+       arena.used = other.arena.used;
+       arena.freeList = other.arena.freeList;
+       arena.nodes[headerIndex].left = other.root();
+       leftmost = other.leftmost;
+       rightmost = other.rightmost;
+       mapSize = other.mapSize;
+   }
+
+   // Exchanges the slot arrays and everything indexing into them; indices
+   // are position independent, so nothing needs relinking.
+   void swapArena(arena_map &other) noexcept {
+       std::swap(arena.nodes, other.arena.nodes);
+       std::swap(arena.capacity, other.arena.capacity);
+       std::swap(arena.used, other.arena.used);
+       std::swap(arena.freeList, other.arena.freeList);
+       std::swap(leftmost, other.leftmost);
+       std::swap(rightmost, other.rightmost);
+       std::swap(mapSize, other.mapSize);
+   }
+
+   // Allocators are only assigned or swapped when they propagate, so
+   // polymorphic_allocator, which allows neither, works.
+   void copyAllocator(const arena_map &other, std::true_type) {
+       if (arena.allocator() != other.arena.allocator()) {
+           releaseArena();
+           arena.allocator() = other.arena.allocator();
+           resetArena();
+       }
+   }
+
+   void copyAllocator(const arena_map &, std::false_type) {}
+
+   void moveAllocator(arena_map &other, std::true_type) {
+       arena.allocator() = other.arena.allocator();
+   }
+
+   void moveAllocator(arena_map &, std::false_type) {}
+
+   void swapAllocators(arena_map &other, std::true_type) {
+       using std::swap;
+       swap(arena.allocator(), other.arena.allocator());
+   }
+
+   void swapAllocators(arena_map &, std::false_type) {}
+
+   // Move assignment when other's arena can always be taken over.
+   void moveAssign(arena_map &other, std::true_type) {
+       releaseArena();
+       moveAllocator(other, typename AllocTraits::propagate_on_container_move_assignment());
+       swapArena(other);
+       other.resetArena();
+   }
+
+   // Otherwise only from an equal allocator; from a different one each
+   // element is moved into this map's own arena.
+   void moveAssign(arena_map &other, std::false_type) {
+       if (arena.allocator() == other.arena.allocator()) {
+           moveAssign(other, std::true_type());
+       } else {
+           copyArena(other, std::true_type());
+           other.clear();
+       }
+   }
+
+   void replaceChild(index_type parent, index_type oldChild, index_type newChild) {
+       if (node(parent).left == oldChild) {
+           node(parent).left = newChild;
+       } else {
+           node(parent).right = newChild;
+       }
+   }
+
+   index_type rightRotate(index_type y) {
+       index_type x = node(y).left;
+       index_type t2 = node(x).right;
+
+       node(x).right = y;
+       node(y).left = t2;
+
+       if (t2 != nil) node(t2).parent = y;
+       node(x).parent = node(y).parent;
+       replaceChild(node(y).parent, y, x);
+       node(y).parent = x;
+
+       return x;
+   }
+
+   index_type leftRotate(index_type x) {
+       index_type y = node(x).right;
+       index_type t2 = node(y).left;
+
+       node(y).left = x;
+       node(x).right = t2;
+
+       if (t2 != nil) node(t2).parent = x;
+       node(y).parent = node(x).parent;
+       replaceChild(node(x).parent, x, y);
+       node(x).parent = y;
+
+       return y;
+   }
+
+   index_type rotateLeft(index_type x) {
+       index_type z = leftRotate(x);
+       if (node(z).balance == 0) {
+           node(x).balance = 1;
+           node(z).balance = -1;
+       } else {
+           node(x).balance = 0;
+           node(z).balance = 0;
+       }
+       return z;
+   }
+
+   index_type rotateRight(index_type x) {
+       index_type z = rightRotate(x);
+       if (node(z).balance == 0) {
+           node(x).balance = -1;
+           node(z).balance = 1;
+       } else {
+           node(x).balance = 0;
+           node(z).balance = 0;
+       }
+       return z;
+   }
+
+   index_type rotateRightLeft(index_type x) {
+       index_type z = node(x).right;
+       index_type y = node(z).left;
+       int b = node(y).balance;
+       rightRotate(z);
+       leftRotate(x);
+       node(x).balance = b > 0 ? -1 : 0;
+       node(z).balance = b < 0 ? 1 : 0;
+       node(y).balance = 0;
+       return y;
+   }
+
+   index_type rotateLeftRight(index_type x) {
+       index_type z = node(x).left;
+       index_type y = node(z).right;
+       int b = node(y).balance;
+       leftRotate(z);
+       rightRotate(x);
+       node(x).balance = b < 0 ? 1 : 0;
+       node(z).balance = b > 0 ? -1 : 0;
+       node(y).balance = 0;
+       return y;
+   }
+
+   void rebalanceAfterInsert(index_type child) {
+       for (index_type p = node(child).parent; p != headerIndex; child = p, p = node(p).parent) {
+           int b = node(p).balance;
+           if (child == node(p).left) {
+               if (b > 0) {
+                   node(p).balance = 0;
+                   return;
+               }
+               if (b == 0) {
+                   node(p).balance = -1;
+                   continue;
+               }
+               if (node(child).balance > 0) {
+                   rotateLeftRight(p);
+               } else {
+                   rotateRight(p);
+               }
+               return;
+           } else {
+               if (b < 0) {
+                   node(p).balance = 0;
+                   return;
+               }
+               if (b == 0) {
+                   node(p).balance = 1;
+                   continue;
+               }
+               if (node(child).balance < 0) {
+                   rotateRightLeft(p);
+               } else {
+                   rotateLeft(p);
+               }
+               return;
+           }
+       }
+   }
+
+   void rebalanceAfterErase(index_type p, bool fromLeft) {
+       while (p != headerIndex) {
+           index_type g = node(p).parent;
+           bool isLeft = node(g).left == p;
+           int b = node(p).balance;
+           if (fromLeft) {
+               if (b == 0) {
+                   node(p).balance = 1;
+                   return;
+               }
+               if (b < 0) {
+                   node(p).balance = 0;
+               } else if (node(node(p).right).balance < 0) {
+                   rotateRightLeft(p);
+               } else {
+                   bool sameHeight = node(node(p).right).balance == 0;
+                   rotateLeft(p);
+                   if (sameHeight) return;
+               }
+           } else {
+               if (b == 0) {
+                   node(p).balance = -1;
+                   return;
+               }
+               if (b > 0) {
+                   node(p).balance = 0;
+               } else if (node(node(p).left).balance > 0) {
+                   rotateLeftRight(p);
+               } else {
+                   bool sameHeight = node(node(p).left).balance == 0;
+                   rotateRight(p);
+                   if (sameHeight) return;
+               }
+           }
+           fromLeft = isLeft;
+           p = g;
+       }
+   }
+
+   // Same descent as map::findInsertPos, including the append/prepend check
+   // against the cached extremes.
+   index_type findInsertPos(const Key &key, index_type &parent, bool &toLeft) const {
+       index_type current = root();
+       index_type candidate = nil;
+       parent = headerIndex;
+       toLeft = true;
+       if (current != nil) {
+           parent = current;
+           if (comp()(key, keyOf(current))) {
+               if (comp()(key, keyOf(leftmost))) {
+                   parent = leftmost;
+                   return nil;
+               }
+               current = node(current).left;
+           } else {
+               toLeft = false;
+               if (comp()(keyOf(rightmost), key)) {
+                   parent = rightmost;
+                   return nil;
+               }
+               candidate = current;
+               current = node(current).right;
+           }
+       }
+       while (current != nil) {
+           parent = current;
+           if (comp()(key, keyOf(current))) {
+               toLeft = true;
+               current = node(current).left;
+           } else {
+               toLeft = false;
+               candidate = current;
+               current = node(current).right;
+           }
+       }
+       if (candidate != nil && !comp()(keyOf(candidate), key)) {
+           return candidate;
+       }
+       return nil;
+   }
+
+   // `i` must already be allocated: allocation may move the arena, indices
+   // taken before it stay valid.
+   index_type attachNode(index_type parent, bool toLeft, index_type i) {
+       node(i).parent = parent;
+       if (toLeft) {
+           node(parent).left = i;
+           if (parent == leftmost) leftmost = i;
+       } else {
+           node(parent).right = i;
+       }
+       if (parent == headerIndex || (!toLeft && parent == rightmost)) {
+           rightmost = i;
+       }
+       mapSize++;
+       rebalanceAfterInsert(i);
+       return i;
+   }
+
+   index_type findMin(index_type i) const {
+       while (node(i).left != nil) {
+           i = node(i).left;
+       }
+       return i;
+   }
+
+   index_type findMax(index_type i) const {
+       while (node(i).right != nil) {
+           i = node(i).right;
+       }
+       return i;
+   }
+
+   index_type findInorderSuccessor(index_type n) const {
+       if (node(n).right != nil) {
+           return findMin(node(n).right);
+       }
+
+       index_type p = node(n).parent;
+       while (p != nil && n == node(p).right) {
+           n = p;
+           p = node(p).parent;
+       }
+       return p;
+   }
+
+   index_type findInorderPredecessor(index_type n) const {
+       if (node(n).left != nil) {
+           return findMax(node(n).left);
+       }
+
+       index_type p = node(n).parent;
+       while (p != nil && n == node(p).left) {
+           n = p;
+           p = node(p).parent;
+       }
+       return p;
+   }
+
+   void eraseNode(index_type n) {
+       if (n == leftmost) {
+           leftmost = node(n).right != nil ? findMin(node(n).right) : node(n).parent;
+       }
+       if (n == rightmost) {
+           rightmost = node(n).left != nil ? findMax(node(n).left) : node(n).parent;
+       }
+
+       index_type retraceFrom;
+       bool fromLeft;
+       index_type l = node(n).left, r = node(n).right;
+       if (l != nil && r != nil) {
+           index_type succ = findMin(r);
+           if (succ != r) {
+               retraceFrom = node(succ).parent;
+               fromLeft = true;
+               node(retraceFrom).left = node(succ).right;
+               if (node(succ).right != nil) node(node(succ).right).parent = retraceFrom;
+               node(succ).right = r;
+               node(r).parent = succ;
+           } else {
+               retraceFrom = succ;
+               fromLeft = false;
+           }
+           node(succ).left = l;
+           node(l).parent = succ;
+           node(succ).parent = node(n).parent;
+           node(succ).balance = node(n).balance;
+           replaceChild(node(n).parent, n, succ);
+       } else {
+           index_type child = l != nil ? l : r;
+           retraceFrom = node(n).parent;
+           fromLeft = node(retraceFrom).left == n;
+           if (child != nil) node(child).parent = retraceFrom;
+           replaceChild(retraceFrom, n, child);
+       }
+       dropNode(n);
+       mapSize--;
+       rebalanceAfterErase(retraceFrom, fromLeft);
+   }
+
+   index_type findNode(const Key &key) const {
+       index_type current = root();
+       while (current != nil) {
+           if (comp()(key, keyOf(current))) {
+               current = node(current).left;
+           } else if (comp()(keyOf(current), key)) {
+               current = node(current).right;
+           } else {
+               return current;
+           }
+       }
+       return nil;
+   }
+
+  public:
+   class const_iterator;
+   class iterator {
+      private:
+       arena_map *container;
+       index_type index;
+
+      public:
+       iterator() : container(nullptr), index(nil) {}
+
+       iterator(arena_map *c, index_type i) : container(c), index(i) {}
+
+       iterator(const iterator &other) : container(other.container), index(other.index) {}
+
+       iterator &operator=(const iterator &other) = default;
+
+       iterator operator++(int) {
+           iterator tmp = *this;
+           ++*this;
+           return tmp;
+       }
+
+       iterator &operator++() {
+           if (!container || index == headerIndex) {
+               throw invalid_iterator();
+           }
+           index = container->findInorderSuccessor(index);
+           return *this;
+       }
+
+       iterator operator--(int) {
+           iterator tmp = *this;
+           --*this;
+           return tmp;
+       }
+
+       iterator &operator--() {
+           if (!container) {
+               throw invalid_iterator();
+           }
+           index_type prev = index == headerIndex ?
+                             container->rightmost : container->findInorderPredecessor(index);
+           if (prev == nil || prev == headerIndex) {
+               throw invalid_iterator();
+           }
+           index = prev;
+           return *this;
+       }
+
+       value_type &operator*() const {
+           if (!container || index == headerIndex) {
+               throw invalid_iterator();
+           }
+           return container->node(index).data;
+       }
+
+       bool operator==(const iterator &rhs) const {
+           return container == rhs.container && index == rhs.index;
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return container == rhs.container && index == rhs.index;
+       }
+
+       bool operator!=(const iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       value_type *operator->() const noexcept {
+           return &(container->node(index).data);
+       }
+
+       friend class const_iterator;
+       friend class arena_map;
+   };
+
+   class const_iterator {
+      private:
+       const arena_map *container;
+       index_type index;
+
+      public:
+       const_iterator() : container(nullptr), index(nil) {}
+
+       const_iterator(const arena_map *c, index_type i) : container(c), index(i) {}
+
+       const_iterator(const const_iterator &other) : container(other.container), index(other.index) {}
+
+       const_iterator(const iterator &other) : container(other.container), index(other.index) {}
+
+       const_iterator &operator=(const const_iterator &other) = default;
+
+       const_iterator operator++(int) {
+           const_iterator tmp = *this;
+           ++*this;
+           return tmp;
+       }
+
+       const_iterator &operator++() {
+           if (!container || index == headerIndex) {
+               throw invalid_iterator();
+           }
+           index = container->findInorderSuccessor(index);
+           return *this;
+       }
+
+       const_iterator operator--(int) {
+           const_iterator tmp = *this;
+           --*this;
+           return tmp;
+       }
+
+       const_iterator &operator--() {
+           if (!container) {
+               throw invalid_iterator();
+           }
+           index_type prev = index == headerIndex ?
+                             container->rightmost : container->findInorderPredecessor(index);
+           if (prev == nil || prev == headerIndex) {
+               throw invalid_iterator();
+           }
+           index = prev;
+           return *this;
+       }
+
+       const value_type &operator*() const {
+           if (!container || index == headerIndex) {
+               throw invalid_iterator();
+           }
+           return container->node(index).data;
+       }
+
+       bool operator==(const iterator &rhs) const {
+           return container == rhs.container && index == rhs.index;
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return container == rhs.container && index == rhs.index;
+       }
+
+       bool operator!=(const iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       const value_type *operator->() const noexcept {
+           return &(container->node(index).data);
+       }
+
+       friend class arena_map;
+   };
+
+   arena_map() : arena(Allocator()) {
+       resetArena();
+   }
+
+   explicit arena_map(const Compare &c, const Allocator &alloc = Allocator())
+       : detail::ebo_storage<Compare>(c), arena(alloc) {
+       resetArena();
+   }
+
+   explicit arena_map(const Allocator &alloc) : arena(alloc) {
+       resetArena();
+   }
+
+   arena_map(const arena_map &other)
+       : detail::ebo_storage<Compare>(other.comp()),
+         arena(AllocTraits::select_on_container_copy_construction(other.arena.allocator())) {
+       resetArena();
+       try {
+           copyArena(other);
+       } catch (...) {
+           releaseArena();
+           throw;
+       }
+   }
+
+   arena_map &operator=(const arena_map &other) {
+       if (this != &other) {
+           clear();
+           this->get() = other.comp();
+           copyAllocator(other, typename AllocTraits::propagate_on_container_copy_assignment());
+           copyArena(other);
+       }
+       return *this;
+   }
+
+   // The moved-from map is left empty without an arena, so moving never
+   // allocates and containers of maps relocate them instead of copying.
+   arena_map(arena_map &&other) noexcept
+       : detail::ebo_storage<Compare>(other.comp()), arena(other.arena.allocator()) {
+       resetArena();
+       swapArena(other);
+   }
+
+   arena_map &operator=(arena_map &&other) noexcept(
+       AllocTraits::propagate_on_container_move_assignment::value ||
+       AllocTraits::is_always_equal::value) {
+       if (this != &other) {
+           clear();
+           this->get() = other.comp();
+           moveAssign(other, std::integral_constant<bool,
+               AllocTraits::propagate_on_container_move_assignment::value ||
+               AllocTraits::is_always_equal::value>());
+       }
+       return *this;
+   }
+
+   // O(1). Unless the allocator propagates on swap the two allocators must
+   // compare equal.
+   void swap(arena_map &other) noexcept {
+       if (this == &other) return;
+       std::swap(this->get(), other.get());
+       swapAllocators(other, typename AllocTraits::propagate_on_container_swap());
+       swapArena(other);
+   }
+
+   friend void swap(arena_map &a, arena_map &b) noexcept {
+       a.swap(b);
+   }
+
+   ~arena_map() {
+       releaseArena();
+   }
+
+   Compare key_comp() const {
+       return comp();
+   }
+
+   allocator_type get_allocator() const {
+       return arena.allocator();
+   }
+
+   T &at(const Key &key) {
+       index_type i = findNode(key);
+       if (i == nil) {
+           throw index_out_of_bound();
+       }
+       return node(i).data.second;
+   }
+
+   const T &at(const Key &key) const {
+       index_type i = findNode(key);
+       if (i == nil) {
+           throw index_out_of_bound();
+       }
+       return node(i).data.second;
+   }
+
+   T &operator[](const Key &key) {
+       index_type parent;
+       bool toLeft;
+       index_type i = findInsertPos(key, parent, toLeft);
+       if (i == nil) {
+           i = attachNode(parent, toLeft, createNode(std::piecewise_construct, std::forward_as_tuple(key),
+                                                   std::forward_as_tuple()));
+       }
+       return node(i).data.second;
+   }
+
+   const T &operator[](const Key &key) const {
+       return at(key);
+   }
+
+   iterator begin() {
+       return iterator(this, leftmost);
+   }
+
+   const_iterator cbegin() const {
+       return const_iterator(this, leftmost);
+   }
+
+   iterator end() {
+       return iterator(this, headerIndex);
+   }
+
+   const_iterator cend() const {
+       return const_iterator(this, headerIndex);
+   }
+
+   bool empty() const {
+       return mapSize == 0;
+   }
+
+   size_t size() const {
+       return mapSize;
+   }
+
+   // Keeps the arena's capacity for reuse.
+   void clear() noexcept {
+       destroyAll();
+       resetArena();
+   }
+
+   pair<iterator, bool> insert(const value_type &value) {
+       index_type parent;
+       bool toLeft;
+       index_type i = findInsertPos(value.first, parent, toLeft);
+       if (i != nil) {
+           return pair<iterator, bool>(iterator(this, i), false);
+       }
+       i = attachNode(parent, toLeft, createNode(value));
+       return pair<iterator, bool>(iterator(this, i), true);
+   }
+
+   pair<iterator, bool> insert(value_type &&value) {
+       index_type parent;
+       bool toLeft;
+       index_type i = findInsertPos(value.first, parent, toLeft);
+       if (i != nil) {
+           return pair<iterator, bool>(iterator(this, i), false);
+       }
+       i = attachNode(parent, toLeft, createNode(std::move(value)));
+       return pair<iterator, bool>(iterator(this, i), true);
+   }
+
+   template<class... Args>
+   pair<iterator, bool> try_emplace(const Key &key, Args&&... args) {
+       index_type parent;
+       bool toLeft;
+       index_type i = findInsertPos(key, parent, toLeft);
+       if (i != nil) {
+           return pair<iterator, bool>(iterator(this, i), false);
+       }
+       i = attachNode(parent, toLeft, createNode(std::piecewise_construct, std::forward_as_tuple(key),
+                                                   std::forward_as_tuple(std::forward<Args>(args)...)));
+       return pair<iterator, bool>(iterator(this, i), true);
+   }
+
+   template<class M>
+   pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+       index_type parent;
+       bool toLeft;
+       index_type i = findInsertPos(key, parent, toLeft);
+       if (i != nil) {
+           node(i).data.second = std::forward<M>(obj);
+           return pair<iterator, bool>(iterator(this, i), false);
+       }
+       i = attachNode(parent, toLeft, createNode(key, std::forward<M>(obj)));
+       return pair<iterator, bool>(iterator(this, i), true);
+   }
+
+   iterator erase(iterator pos) {
+       if (pos.container != this || pos.index == headerIndex || pos.index == nil) {
+           throw invalid_iterator();
+       }
+
+       iterator next(this, findInorderSuccessor(pos.index));
+       eraseNode(pos.index);
+       return next;
+   }
+
+   size_t erase(const Key &key) {
+       index_type i = findNode(key);
+       if (i == nil) return 0;
+       eraseNode(i);
+       return 1;
+   }
+
+   size_t count(const Key &key) const {
+       return findNode(key) != nil ? 1 : 0;
+   }
+
+   iterator find(const Key &key) {
+       index_type i = findNode(key);
+       return iterator(this, i != nil ? i : headerIndex);
+   }
+
+   const_iterator find(const Key &key) const {
+       index_type i = findNode(key);
+       return const_iterator(this, i != nil ? i : headerIndex);
+   }
+};
+
+}
+
+#endif
@@ -7,543 +7,2589 @@
 // only for std::less<T>
 #include <functional>
 #include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define SJTU_MAP_HAS_PMR 1
+#endif
+#endif
+#if __cplusplus > 201703L && defined(__has_include)
+#if __has_include(<compare>)
+#include <compare>
+#endif
+#endif
+#if defined(__cpp_lib_three_way_comparison) && __cpp_lib_three_way_comparison >= 201907L
+#define SJTU_MAP_HAS_SPACESHIP 1
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define SJTU_MAP_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define SJTU_MAP_PREFETCH(p) ((void)0)
+#endif
 #include "utility.hpp"
 #include "exceptions.hpp"
 
 namespace sjtu {
 
-template<
-   class Key,
-   class T,
-   class Compare = std::less <Key>
-   > class map {
+template<class Key, class Compare>
+struct key_prefix;
+
+namespace detail {
+
+// Holds a comparator or allocator as a base class when it is empty, so a
+// stateless one takes no space in the object that derives from this.
+template<class T, bool = std::is_empty<T>::value && !std::is_final<T>::value>
+class ebo_storage {
+   T value;
+
   public:
-   typedef pair<const Key, T> value_type;
+   ebo_storage() : value() {}
+   explicit ebo_storage(const T &v) : value(v) {}
+   T &get() { return value; }
+   const T &get() const { return value; }
+};
 
-  private:
-   struct Node {
-       value_type data;
-       Node *left, *right, *parent;
-       int height;
+template<class T>
+class ebo_storage<T, true> : private T {
+  public:
+   ebo_storage() : T() {}
+   explicit ebo_storage(const T &v) : T(v) {}
+   T &get() { return *this; }
+   const T &get() const { return *this; }
+};
 
-       Node(const value_type &val)
-           : data(val), left(nullptr), right(nullptr), parent(nullptr), height(1) {}
-   };
+// True when an augmentation policy's node data keeps subtree sizes.
+template<class Data, class = void>
+struct counts_subtrees : std::false_type {};
 
-   Node *root;
-   size_t mapSize;
-   Compare comp;
+template<class Data>
+struct counts_subtrees<Data, decltype(void(&Data::size))> : std::true_type {};
 
-   int getHeight(Node *node) {
-       return node ? node->height : 0;
-   }
+template<class>
+struct make_void {
+   typedef void type;
+};
 
-   int getBalance(Node *node) {
-       return node ? getHeight(node->left) - getHeight(node->right) : 0;
+// Lookups take any type the comparator accepts when Compare declares
+// is_transparent, and only Key itself otherwise.
+template<class Compare, class K, class Key, class = void>
+struct is_lookup_key : std::is_same<K, Key> {};
+
+template<class Compare, class K, class Key>
+struct is_lookup_key<Compare, K, Key, typename make_void<typename Compare::is_transparent>::type>
+   : std::true_type {};
+
+// Three-way comparison of a lookup key K against a stored Key, for one
+// comparator call per tree level. A comparator opts in with a member
+// compare(a, b) whose result orders against 0 like strcmp's. Failing
+// that, std::less on a class type with operator<=> uses <=>; arithmetic
+// keys stay on operator<, which is already a single instruction.
+template<class Compare, class K, class Key, class = void>
+struct has_compare : std::false_type {};
+
+template<class Compare, class K, class Key>
+struct has_compare<Compare, K, Key, typename make_void<decltype(
+   std::declval<const Compare&>().compare(std::declval<const K&>(), std::declval<const Key&>()) < 0)>::type>
+   : std::true_type {};
+
+template<class Compare, class K, class Key, class = void>
+struct has_spaceship : std::false_type {};
+
+#ifdef SJTU_MAP_HAS_SPACESHIP
+template<class Compare, class K, class Key>
+struct has_spaceship<Compare, K, Key, typename make_void<decltype(
+   std::declval<const K&>() <=> std::declval<const Key&>() < 0)>::type>
+   : std::integral_constant<bool, std::is_class<Key>::value &&
+                                  (std::is_same<Compare, std::less<Key> >::value ||
+                                   std::is_same<Compare, std::less<> >::value)> {};
+#endif
+
+template<class Compare, class K, class Key,
+         int = has_compare<Compare, K, Key>::value ? 1 : has_spaceship<Compare, K, Key>::value ? 2 : 0>
+struct three_way : std::false_type {};
+
+template<class Compare, class K, class Key>
+struct three_way<Compare, K, Key, 1> : std::true_type {
+   static auto order(const Compare &comp, const K &a, const Key &b) -> decltype(comp.compare(a, b)) {
+       return comp.compare(a, b);
    }
+};
 
-   void updateHeight(Node *node) {
-       if (node) {
-           node->height = 1 + (getHeight(node->left) > getHeight(node->right) ?
-                              getHeight(node->left) : getHeight(node->right));
-       }
+#ifdef SJTU_MAP_HAS_SPACESHIP
+template<class Compare, class K, class Key>
+struct three_way<Compare, K, Key, 2> : std::true_type {
+   static auto order(const Compare &, const K &a, const Key &b) -> decltype(a <=> b) {
+       return a <=> b;
    }
+};
+#endif
+
+// std::less or std::greater on arithmetic keys: the comparison is one
+// instruction, so findNode descends without data-dependent branches.
+template<class Compare, class K, class Key>
+struct branchless_search : std::integral_constant<bool,
+   std::is_arithmetic<Key>::value && std::is_arithmetic<K>::value &&
+   (std::is_same<Compare, std::less<Key> >::value || std::is_same<Compare, std::greater<Key> >::value ||
+    std::is_same<Compare, std::less<> >::value || std::is_same<Compare, std::greater<> >::value)> {};
+
+// True when key_prefix has been specialized for Key and Compare.
+template<class Key, class Compare, class = void>
+struct has_key_prefix : std::false_type {};
+
+template<class Key, class Compare>
+struct has_key_prefix<Key, Compare, typename make_void<decltype(
+   key_prefix<Key, Compare>::get(std::declval<const Key&>()))>::type> : std::true_type {};
+
+// Storage for a node's cached key prefix, empty unless the hook is used.
+template<bool>
+struct prefix_slot {};
+
+template<>
+struct prefix_slot<true> {
+   std::uint64_t prefix;
+};
 
-   Node* rightRotate(Node *y) {
-       Node *x = y->left;
-       Node *T2 = x->right;
-
-       x->right = y;
-       y->left = T2;
+// True when an augmentation policy's node data parks pending updates.
+template<class Data, class = void>
+struct keeps_tags : std::false_type {};
 
-       if (T2) T2->parent = y;
-       x->parent = y->parent;
-       y->parent = x;
+template<class Data>
+struct keeps_tags<Data, decltype(void(&Data::pending))> : std::true_type {};
 
-       updateHeight(y);
-       updateHeight(x);
+// True when an augmentation policy's node data depends on the mapped
+// values: aggregates computed from them, or updates still owed to them.
+template<class Data, class = void>
+struct tracks_values : keeps_tags<Data> {};
 
-       return x;
-   }
+template<class Data>
+struct tracks_values<Data, typename make_void<typename Data::aggregate_type>::type> : std::true_type {};
 
-   Node* leftRotate(Node *x) {
-       Node *y = x->right;
-       Node *T2 = y->left;
+}
 
-       y->left = x;
-       x->right = T2;
+// Augmentation policies: data kept in every tree node and recomputed
+// bottom-up whenever the node's children change, so it is always correct
+// for the node's current subtree. node<Key, T> becomes a base of the tree
+// node, and pull() receives the node's element and its children, null
+// when absent.
+struct no_augment {
+   template<class Key, class T>
+   struct node {
+       void pull(const pair<const Key, T> &, const node *, const node *) {}
+   };
+};
 
-       if (T2) T2->parent = x;
-       y->parent = x->parent;
-       x->parent = y;
+// Subtree sizes, for rank(), select(), count_range(), advance() and
+// distance() in O(log n), at one size_t per node.
+struct order_statistics {
+   template<class Key, class T>
+   struct node {
+       size_t size;
 
-       updateHeight(x);
-       updateHeight(y);
+       void pull(const pair<const Key, T> &, const node *left, const node *right) {
+           size = 1 + (left ? left->size : 0) + (right ? right->size : 0);
+       }
+   };
+};
 
-       return y;
-   }
+// Keeps Monoid's combination of all elements in each subtree, in key
+// order, for aggregate(lo, hi) in O(log n). Monoid is default constructible
+// and provides
+//   value_type                       the aggregate type
+//   identity()                       the neutral element
+//   project(key, value)              one element's contribution
+//   combine(a, b)                    associative; a covers smaller keys
+// With this policy, at(), operator[] and iterators only give const access
+// to mapped values; they change through update(), insert_or_assign() or
+// apply_batch(), which recompute the aggregates above them.
+template<class Monoid>
+struct range_aggregate {
+   template<class Key, class T>
+   struct node {
+       typedef Monoid monoid_type;
+       typedef typename Monoid::value_type aggregate_type;
+
+       aggregate_type total;
+
+       void pull(const pair<const Key, T> &value, const node *left, const node *right) {
+           Monoid monoid;
+           aggregate_type own = monoid.project(value.first, value.second);
+           total = left ? monoid.combine(left->total, own) : own;
+           if (right) total = monoid.combine(total, right->total);
+       }
+   };
+};
 
-   Node* balanceNode(Node *node) {
-       if (!node) return nullptr;
+// Monoids over the mapped values for range_aggregate.
+template<class V>
+struct sum_of {
+   typedef V value_type;
+   V identity() const { return V(); }
+   template<class K, class T>
+   V project(const K &, const T &value) const { return V(value); }
+   V combine(const V &a, const V &b) const { return a + b; }
+};
 
-       updateHeight(node);
+template<class V>
+struct min_of {
+   typedef V value_type;
+   V identity() const { return std::numeric_limits<V>::max(); }
+   template<class K, class T>
+   V project(const K &, const T &value) const { return V(value); }
+   V combine(const V &a, const V &b) const { return b < a ? b : a; }
+};
 
-       int balance = getBalance(node);
+template<class V>
+struct max_of {
+   typedef V value_type;
+   V identity() const { return std::numeric_limits<V>::lowest(); }
+   template<class K, class T>
+   V project(const K &, const T &value) const { return V(value); }
+   V combine(const V &a, const V &b) const { return a < b ? b : a; }
+};
 
-       if (balance > 1) {
-           if (getBalance(node->left) >= 0) {
-               Node *newRoot = rightRotate(node);
-               if (newRoot->parent) {
-                   if (newRoot->parent->left == node) {
-                       newRoot->parent->left = newRoot;
-                   } else {
-                       newRoot->parent->right = newRoot;
-                   }
-               }
-               return newRoot;
-           } else {
-               node->left = leftRotate(node->left);
-               node->left->parent = node;
-               Node *newRoot = rightRotate(node);
-               if (newRoot->parent) {
-                   if (newRoot->parent->left == node) {
-                       newRoot->parent->left = newRoot;
-                   } else {
-                       newRoot->parent->right = newRoot;
-                   }
-               }
-               return newRoot;
-           }
-       }
+struct count_of {
+   typedef size_t value_type;
+   size_t identity() const { return 0; }
+   template<class K, class T>
+   size_t project(const K &, const T &) const { return 1; }
+   size_t combine(size_t a, size_t b) const { return a + b; }
+};
 
-       if (balance < -1) {
-           if (getBalance(node->right) <= 0) {
-               Node *newRoot = leftRotate(node);
-               if (newRoot->parent) {
-                   if (newRoot->parent->left == node) {
-                       newRoot->parent->left = newRoot;
-                   } else {
-                       newRoot->parent->right = newRoot;
-                   }
-               }
-               return newRoot;
-           } else {
-               node->right = rightRotate(node->right);
-               node->right->parent = node;
-               Node *newRoot = leftRotate(node);
-               if (newRoot->parent) {
-                   if (newRoot->parent->left == node) {
-                       newRoot->parent->left = newRoot;
-                   } else {
-                       newRoot->parent->right = newRoot;
-                   }
-               }
-               return newRoot;
-           }
+// Opt-in hook for keys whose comparison reads memory outside the node,
+// such as strings and big integers. Specialize key_prefix<Key, Compare>
+// with
+//   static std::uint64_t get(const Key &key);
+// returning a prefix that orders like Compare: !comp(b, a) implies
+// get(a) <= get(b), so keys that compare equivalent have equal prefixes
+// and a lookup never skips its match. Each node then caches its key's
+// prefix, and lookups compare prefixes first and call Compare only on
+// ties, so most levels of a descent touch nothing but node memory. A big
+// integer could use its sign and top limb; strings under std::less can
+// use string_prefix:
+//   template<> struct sjtu::key_prefix<std::string, std::less<std::string> >
+//       : sjtu::string_prefix {};
+template<class Key, class Compare>
+struct key_prefix {};
+
+// The first 8 bytes, big-endian and zero-padded, which orders like
+// std::less on std::string: characters compare as unsigned char, and a
+// shorter string sorts first.
+struct string_prefix {
+   template<class S>
+   static std::uint64_t get(const S &s) {
+       std::uint64_t prefix = 0;
+       size_t n = s.size() < 8 ? s.size() : 8;
+       for (size_t i = 0; i < n; ++i) {
+           prefix |= std::uint64_t((unsigned char)s[i]) << (56 - 8 * i);
        }
-
-       return node;
+       return prefix;
    }
+};
 
-   Node* insertNode(Node *node, const value_type &value) {
-       if (!node) {
-           mapSize++;
-           return new Node(value);
+// Lazy range updates for range_apply(lo, hi, op) in O(log n). Instead of
+// visiting every value in the range, an op is parked as a tag on the roots
+// of the subtrees the range covers, and handed down to the children when
+// a node is next visited. Action is default constructible and provides
+//   op_type                          the update
+//   apply(op, key, value)            updates one value in place
+//   compose(later, earlier)          the op doing earlier, then later
+// neither of which may throw. A node's own value is always current; its
+// tag is owed by its descendants. Reads push tags down, so even const
+// lookups write to the tree. As with range_aggregate, mapped values are
+// only reachable as const, since a held reference would miss later ops.
+template<class Action>
+struct range_update {
+   template<class Key, class T>
+   struct node {
+       typedef typename Action::op_type op_type;
+
+       op_type tag;
+       bool pending = false;
+
+       void pull(const pair<const Key, T> &, const node *, const node *) {}
+
+       void apply(pair<const Key, T> &value, const op_type &op) {
+           Action().apply(op, value.first, value.second);
        }
 
-       if (comp(value.first, node->data.first)) {
-           node->left = insertNode(node->left, value);
-           node->left->parent = node;
-       } else if (comp(node->data.first, value.first)) {
-           node->right = insertNode(node->right, value);
-           node->right->parent = node;
-       } else {
-           return node;
+       void defer(const op_type &op) {
+           tag = pending ? Action().compose(op, tag) : op;
+           pending = true;
        }
+   };
+};
+
+// value * mul + add on arithmetic values, for range_update.
+template<class V>
+struct affine {
+   struct op_type {
+       V mul, add;
+   };
+
+   static op_type add(const V &delta) { return op_type{V(1), delta}; }
+   static op_type scale(const V &factor) { return op_type{factor, V(0)}; }
+   static op_type assign(const V &value) { return op_type{V(0), value}; }
 
-       return balanceNode(node);
+   template<class K>
+   void apply(const op_type &op, const K &, V &value) const {
+       value = value * op.mul + op.add;
    }
 
-   Node* findMin(Node *node) {
-       while (node && node->left) {
-           node = node->left;
-       }
-       return node;
+   op_type compose(const op_type &later, const op_type &earlier) const {
+       return op_type{later.mul * earlier.mul, later.mul * earlier.add + later.add};
    }
+};
 
-   Node* eraseNode(Node *node, const Key &key) {
-       if (!node) return nullptr;
+template<
+   class Key,
+   class T,
+   class Compare = std::less <Key>,
+   class Allocator = std::allocator<pair<const Key, T> >,
+   class Augment = no_augment
+   > class map : private detail::ebo_storage<Compare> {
+  public:
+   typedef pair<const Key, T> value_type;
+   typedef Allocator allocator_type;
+
+   // One write for apply_batch(). `value` is ignored by erase.
+   struct batch_op {
+       enum kind_type { insert, assign, erase };
+       kind_type kind;
+       Key key;
+       T value;
+   };
 
-       if (comp(key, node->data.first)) {
-           node->left = eraseNode(node->left, key);
-           if (node->left) node->left->parent = node;
-       } else if (comp(node->data.first, key)) {
-           node->right = eraseNode(node->right, key);
-           if (node->right) node->right->parent = node;
-       } else {
-           if (!node->left || !node->right) {
-               Node *temp = node->left ? node->left : node->right;
+  private:
+   // AVL nodes keep a balance factor, height(right) - height(left), instead
+   // of a height. By default it lives in the two low bits of the parent
+   // pointer, so a node costs three pointers on top of its value; define
+   // SJTU_MAP_NO_POINTER_TAGGING to store it in a separate byte instead.
+   typedef typename Augment::template node<Key, T> AugmentData;
 
-               if (!temp) {
-                   delete node;
-                   mapSize--;
-                   return nullptr;
-               } else {
-                   temp->parent = node->parent;
-                   delete node;
-                   mapSize--;
-                   return temp;
-               }
-           } else {
-               Node *temp = findMin(node->right);
-               const_cast<Key&>(node->data.first) = temp->data.first;
-                   node->data.second = temp->data.second;
-               node->right = eraseNode(node->right, temp->data.first);
-               if (node->right) node->right->parent = node;
-           }
-       }
+   struct NodeBase : AugmentData {
+       NodeBase *left, *right;
+#ifndef SJTU_MAP_NO_POINTER_TAGGING
+       std::uintptr_t parentAndBalance;
 
-       Node *result = balanceNode(node);
-       if (result && result->left) result->left->parent = result;
-       if (result && result->right) result->right->parent = result;
-       return result;
-   }
+       NodeBase() : left(nullptr), right(nullptr), parentAndBalance(1) {}
 
-   void destroy(Node *node) {
-       if (node) {
-           destroy(node->left);
-           destroy(node->right);
-           delete node;
+       NodeBase* parent() const {
+           return reinterpret_cast<NodeBase*>(parentAndBalance & ~std::uintptr_t(3));
        }
-   }
 
-   Node* copyNode(Node *other) {
-       if (!other) return nullptr;
-       Node *node = new Node(other->data);
-       node->left = copyNode(other->left);
-       node->right = copyNode(other->right);
-       node->height = other->height;
-       if (node->left) node->left->parent = node;
-       if (node->right) node->right->parent = node;
-       return node;
-   }
+       void setParent(NodeBase *p) {
+           parentAndBalance = reinterpret_cast<std::uintptr_t>(p) | (parentAndBalance & 3);
+       }
 
-   Node* findNode(const Key &key) const {
-       Node *current = root;
-       while (current) {
-           if (comp(key, current->data.first)) {
-               current = current->left;
-           } else if (comp(current->data.first, key)) {
-               current = current->right;
-           } else {
-               return current;
-           }
+       int balance() const {
+           return int(parentAndBalance & 3) - 1;
        }
-       return nullptr;
-   }
 
-  public:
-   class const_iterator;
-   class iterator {
-      private:
-       map *container;
-       Node *node;
+       void setBalance(int b) {
+           parentAndBalance = (parentAndBalance & ~std::uintptr_t(3)) | std::uintptr_t(b + 1);
+       }
+#else
+       NodeBase *parentLink;
+       signed char balanceFactor;
 
-       Node* findInorderSuccessor(Node *n) {
-           if (!n) return nullptr;
+       NodeBase() : left(nullptr), right(nullptr), parentLink(nullptr), balanceFactor(0) {}
 
-           if (n->right) {
-               Node *curr = n->right;
-               while (curr->left) {
-                   curr = curr->left;
-               }
-               return curr;
-           }
+       NodeBase* parent() const { return parentLink; }
+       void setParent(NodeBase *p) { parentLink = p; }
+       int balance() const { return balanceFactor; }
+       void setBalance(int b) { balanceFactor = (signed char)b; }
+#endif
+   };
 
-           Node *p = n->parent;
-           while (p && n == p->right) {
-               n = p;
-               p = p->parent;
-           }
-           return p;
-       }
+   // The value is constructed and destroyed through the allocator, so it
+   // lives in a union that Node itself leaves alone.
+   static const bool prefixed = detail::has_key_prefix<Key, Compare>::value;
 
-       Node* findInorderPredecessor(Node *n) {
-           if (!n) return nullptr;
+   struct Node : NodeBase, detail::prefix_slot<prefixed> {
+       union {
+           value_type data;
+       };
 
-           if (n->left) {
-               Node *curr = n->left;
-               while (curr->right) {
-                   curr = curr->right;
-               }
-               return curr;
-           }
+       Node() {}
+       ~Node() {}
+   };
+
+   typedef std::allocator_traits<Allocator> AllocTraits;
+
+   // Nodes are carved out of blocks owned by the map, and erased nodes are
+   // kept on a free list for the next insertion. Blocks are chained through
+   // their first slot, come from the map's allocator and are only returned
+   // by release().
+   //
+   // Every node lives in a block of the map that holds it, so a map's
+   // memory always comes back when it is cleared or destroyed: split()
+   // moves the smaller side into nodes of its own, and join() takes over
+   // the other map's blocks together with the slots still free in them.
+   class NodePool : private detail::ebo_storage<Allocator> {
+      private:
+       union Slot;
+
+       struct BlockHeader {
+           Slot *next;
+           size_t size;
+       };
+
+       union Slot {
+           Slot *next;
+           BlockHeader block;
+           alignas(Node) unsigned char storage[sizeof(Node)];
+       };
+
+       typedef typename AllocTraits::template rebind_alloc<Slot> SlotAllocator;
+       typedef typename AllocTraits::template rebind_traits<Slot> SlotTraits;
+
+       static const size_t minBlockSize = 8;
+       static const size_t maxBlockSize = 4096;
+
+       // freeTail is the last free slot, meaningful while freeSlots is not
+       // null, so that adopt() splices free lists in O(1).
+       Slot *blocks, *freeSlots, *freeTail, *nextSlot, *slotEnd;
+       size_t blockSize;
+
+       void newBlock() {
+           SlotAllocator slotAlloc(allocator());
+           Slot *block = SlotTraits::allocate(slotAlloc, blockSize + 1);
+           block->block.next = blocks;
+           block->block.size = blockSize + 1;
+           blocks = block;
+           nextSlot = block + 1;
+           slotEnd = block + 1 + blockSize;
+           if (blockSize < maxBlockSize) blockSize *= 2;
+       }
+
+       static Slot* appendBlocks(Slot *list, Slot *tail) {
+           if (!list) return tail;
+           Slot *last = list;
+           while (last->block.next) last = last->block.next;
+           last->block.next = tail;
+           return list;
+       }
 
-           Node *p = n->parent;
-           while (p && n == p->left) {
-               n = p;
-               p = p->parent;
+       void freeBlocks(Slot *list) {
+           SlotAllocator slotAlloc(allocator());
+           while (list) {
+               Slot *next = list->block.next;
+               SlotTraits::deallocate(slotAlloc, list, list->block.size);
+               list = next;
            }
-           return p;
        }
 
       public:
-       iterator() : container(nullptr), node(nullptr) {}
+       explicit NodePool(const Allocator &a)
+           : detail::ebo_storage<Allocator>(a),
+             blocks(nullptr), freeSlots(nullptr), freeTail(nullptr), nextSlot(nullptr), slotEnd(nullptr),
+             blockSize(minBlockSize) {}
 
-       iterator(map *c, Node *n) : container(c), node(n) {}
+       Allocator &allocator() {
+           return this->get();
+       }
 
-       iterator(const iterator &other) : container(other.container), node(other.node) {}
+       const Allocator &allocator() const {
+           return this->get();
+       }
 
-       iterator operator++(int) {
-           if (!node || !container) {
-               throw invalid_iterator();
-           }
-           iterator tmp = *this;
-           node = findInorderSuccessor(node);
-           return tmp;
+       NodePool(const NodePool &) = delete;
+       NodePool &operator=(const NodePool &) = delete;
+
+       ~NodePool() {
+           release();
        }
 
-       iterator &operator++() {
-           if (!node || !container) {
-               throw invalid_iterator();
+       void *allocate() {
+           if (freeSlots) {
+               Slot *slot = freeSlots;
+               freeSlots = slot->next;
+               return slot;
            }
-           node = findInorderSuccessor(node);
-           return *this;
+           if (nextSlot == slotEnd) newBlock();
+           return nextSlot++;
        }
 
-       iterator operator--(int) {
-           if (!container) {
-               throw invalid_iterator();
-           }
-           iterator tmp = *this;
-           if (!node) {
-               node = container->root;
-               if (node) {
-                   while (node->right) {
-                       node = node->right;
-                   }
-               }
-           } else {
-               node = findInorderPredecessor(node);
-           }
-           if (!node) {
-               throw invalid_iterator();
-           }
-           return tmp;
+       void deallocate(void *p) {
+           Slot *slot = static_cast<Slot*>(p);
+           if (!freeSlots) freeTail = slot;
+           slot->next = freeSlots;
+           freeSlots = slot;
        }
 
-       iterator &operator--() {
-           if (!container) {
-               throw invalid_iterator();
+       // Exchanges the blocks but not the allocators.
+       void swap(NodePool &other) {
+           std::swap(blocks, other.blocks);
+           std::swap(freeSlots, other.freeSlots);
+           std::swap(freeTail, other.freeTail);
+           std::swap(nextSlot, other.nextSlot);
+           std::swap(slotEnd, other.slotEnd);
+           std::swap(blockSize, other.blockSize);
+       }
+
+       // Takes over everything `other` allocated, free slots included, and
+       // leaves it empty. Of the two partly used blocks, the one with more
+       // room left keeps handing out slots and the rest of the other goes
+       // onto the free list. Allocators must compare equal.
+       void adopt(NodePool &other) {
+           blocks = appendBlocks(other.blocks, blocks);
+           other.blocks = nullptr;
+           if (other.freeSlots) {
+               other.freeTail->next = freeSlots;
+               if (!freeSlots) freeTail = other.freeTail;
+               freeSlots = other.freeSlots;
+               other.freeSlots = nullptr;
            }
-           if (!node) {
-               node = container->root;
-               if (node) {
-                   while (node->right) {
-                       node = node->right;
-                   }
-               }
-           } else {
-               node = findInorderPredecessor(node);
+           if (slotEnd - nextSlot < other.slotEnd - other.nextSlot) {
+               std::swap(nextSlot, other.nextSlot);
+               std::swap(slotEnd, other.slotEnd);
            }
-           if (!node) {
-               throw invalid_iterator();
+           for (Slot *slot = other.nextSlot; slot != other.slotEnd; ++slot) {
+               deallocate(slot);
            }
-           return *this;
+           if (blockSize < other.blockSize) blockSize = other.blockSize;
+           other.release();
        }
 
-       value_type &operator*() const {
-           if (!node) {
-               throw invalid_iterator();
-           }
-           return node->data;
+       void release() {
+           freeBlocks(blocks);
+           blocks = nullptr;
+           freeSlots = freeTail = nextSlot = slotEnd = nullptr;
+           blockSize = minBlockSize;
        }
+   };
 
-       bool operator==(const iterator &rhs) const {
-           return container == rhs.container && node == rhs.node;
+   // The header is end(). The root hangs off its left link, so the
+   // in-order successor of the rightmost node climbs to the header on its
+   // own, and the header is the only node whose parent is null.
+   // leftmost/rightmost point at the header while the map is empty.
+   NodeBase header;
+   NodeBase *leftmost, *rightmost;
+   size_t mapSize;
+   NodePool pool;
+
+   const Compare &comp() const {
+       return this->get();
+   }
+
+   // Heterogeneous overloads of the lookups: every public function taking a
+   // key has a template on the key type, enabled by this, and a Key
+   // overload that forwards to it so that conversions to Key still work.
+   template<class K>
+   using EnableLookup = typename std::enable_if<detail::is_lookup_key<Compare, K, Key>::value>::type;
+
+   static Node* asNode(NodeBase *node) {
+       return static_cast<Node*>(node);
+   }
+
+   static const Key& keyOf(NodeBase *node) {
+       return static_cast<Node*>(node)->data.first;
+   }
+
+   template<class... Args>
+   Node* createNode(Args&&... args) {
+       Node *node = ::new (pool.allocate()) Node;
+       try {
+           AllocTraits::construct(pool.allocator(), &node->data, std::forward<Args>(args)...);
+       } catch (...) {
+           pool.deallocate(node);
+           throw;
        }
+       setPrefix(node, std::integral_constant<bool, prefixed>());
+       return node;
+   }
 
-       bool operator==(const const_iterator &rhs) const {
-           return container == rhs.container && node == rhs.node;
+   static void setPrefix(Node *, std::false_type) {}
+
+   static void setPrefix(Node *node, std::true_type) {
+       node->prefix = key_prefix<Key, Compare>::get(node->data.first);
+   }
+
+   // A lookup key as the descents see it: before(node) is key < node and
+   // after(node) is node < key. With a key_prefix hook, the cached prefixes
+   // decide unless they tie, and only then is Compare called.
+   template<class K, bool = prefixed && std::is_same<K, Key>::value>
+   class Probe {
+      public:
+       Probe(const map &m, const K &key) : m(m), key(key) {}
+
+       bool before(NodeBase *node) const { return m.comp()(key, keyOf(node)); }
+       bool after(NodeBase *node) const { return m.comp()(keyOf(node), key); }
+
+       template<class C = Compare>
+       auto order(NodeBase *node) const -> decltype(detail::three_way<C, K, Key>::order(
+           std::declval<const C&>(), std::declval<const K&>(), std::declval<const Key&>())) {
+           return detail::three_way<C, K, Key>::order(m.comp(), key, keyOf(node));
        }
 
-       bool operator!=(const iterator &rhs) const {
-           return !(*this == rhs);
+      private:
+       const map &m;
+       const K &key;
+   };
+
+   template<class K>
+   class Probe<K, true> {
+      public:
+       Probe(const map &m, const K &key)
+           : m(m), key(key), prefix(key_prefix<Key, Compare>::get(key)) {}
+
+       bool before(NodeBase *node) const {
+           std::uint64_t p = asNode(node)->prefix;
+           return prefix != p ? prefix < p : m.comp()(key, keyOf(node));
        }
 
-       bool operator!=(const const_iterator &rhs) const {
-           return !(*this == rhs);
+       bool after(NodeBase *node) const {
+           std::uint64_t p = asNode(node)->prefix;
+           return prefix != p ? p < prefix : m.comp()(keyOf(node), key);
        }
 
-       value_type *operator->() const noexcept {
-           return &(node->data);
+       int order(NodeBase *node) const {
+           std::uint64_t p = asNode(node)->prefix;
+           if (prefix != p) return prefix < p ? -1 : 1;
+           auto result = detail::three_way<Compare, K, Key>::order(m.comp(), key, keyOf(node));
+           return result < 0 ? -1 : result > 0 ? 1 : 0;
        }
 
-       friend class const_iterator;
-       friend class map;
+      private:
+       const map &m;
+       const K &key;
+       std::uint64_t prefix;
    };
 
-   class const_iterator {
-      private:
-       const map *container;
-       Node *node;
+   void dropNode(Node *node) {
+       AllocTraits::destroy(pool.allocator(), &node->data);
+       pool.deallocate(node);
+   }
+
+   NodeBase* root() const {
+       return header.left;
+   }
 
-       Node* findInorderSuccessor(Node *n) {
-           if (!n) return nullptr;
+   NodeBase* endNode() const {
+       return const_cast<NodeBase*>(&header);
+   }
 
-           if (n->right) {
-               Node *curr = n->right;
-               while (curr->left) {
-                   curr = curr->left;
-               }
-               return curr;
-           }
+   // Keeps the policy's data of `node` in step with its children.
+   static void pull(NodeBase *node) {
+       node->pull(asNode(node)->data, node->left, node->right);
+   }
 
-           Node *p = n->parent;
-           while (p && n == p->right) {
-               n = p;
-               p = p->parent;
-           }
-           return p;
+   // Pulls `node` and every ancestor, after the subtree under `node` has
+   // changed. Free when the policy keeps nothing to pull.
+   static void pullPath(NodeBase *node) {
+       if (std::is_empty<AugmentData>::value || keepsTags) return;
+       for (; node->parent(); node = node->parent()) {
+           pull(node);
        }
+   }
 
-       Node* findInorderPredecessor(Node *n) {
-           if (!n) return nullptr;
+   // Pending tags of a range_update policy. A node's tag has to be pushed
+   // to its children before they change, and every tag above a node before
+   // its value is read or written.
+   static const bool keepsTags = detail::keeps_tags<AugmentData>::value;
 
-           if (n->left) {
-               Node *curr = n->left;
-               while (curr->right) {
-                   curr = curr->right;
-               }
-               return curr;
-           }
+   // What at(), operator[] and iterators hand out. Policies that track the
+   // values get const access only, so every write goes through the map.
+   static const bool tracksValues = detail::tracks_values<AugmentData>::value;
+   typedef typename std::conditional<tracksValues, const T, T>::type MappedRef;
+   typedef typename std::conditional<tracksValues, const value_type, value_type>::type ElementRef;
 
-           Node *p = n->parent;
-           while (p && n == p->left) {
-               n = p;
-               p = p->parent;
-           }
-           return p;
+   static void push(NodeBase *node) {
+       push(node, std::integral_constant<bool, keepsTags>());
+   }
+
+   static void push(NodeBase *, std::false_type) {}
+
+   static void push(NodeBase *node, std::true_type) {
+       if (!node->pending) return;
+       node->pending = false;
+       tagSubtree(node->left, node->tag);
+       tagSubtree(node->right, node->tag);
+   }
+
+   // Applies `op` to every value under `node`: its own now, the rest
+   // through its tag.
+   template<class Op>
+   static void tagSubtree(NodeBase *node, const Op &op) {
+       if (!node) return;
+       node->apply(asNode(node)->data, op);
+       if (node->left || node->right) node->defer(op);
+   }
+
+   // Pushes the tags of `node` and all its ancestors.
+   static void pushPath(NodeBase *node) {
+       if (!keepsTags) return;
+       if (NodeBase *p = node->parent()) pushPath(p);
+       push(node);
+   }
+
+   static void replaceChild(NodeBase *parent, NodeBase *oldChild, NodeBase *newChild) {
+       if (parent->left == oldChild) {
+           parent->left = newChild;
+       } else {
+           parent->right = newChild;
        }
+   }
 
-      public:
-       const_iterator() : container(nullptr), node(nullptr) {}
+   // Plain link rotations; the callers fix up balance factors.
+   static NodeBase* rightRotate(NodeBase *y) {
+       push(y);
+       push(y->left);
+       NodeBase *x = y->left;
+       NodeBase *T2 = x->right;
+
+       x->right = y;
+       y->left = T2;
 
-       const_iterator(const map *c, Node *n) : container(c), node(n) {}
+       if (T2) T2->setParent(y);
+       x->setParent(y->parent());
+       replaceChild(y->parent(), y, x);
+       y->setParent(x);
+       pull(y);
+       pull(x);
 
-       const_iterator(const const_iterator &other) : container(other.container), node(other.node) {}
+       return x;
+   }
 
-       const_iterator(const iterator &other) : container(other.container), node(other.node) {}
+   static NodeBase* leftRotate(NodeBase *x) {
+       push(x);
+       push(x->right);
+       NodeBase *y = x->right;
+       NodeBase *T2 = y->left;
 
-       const_iterator operator++(int) {
-           if (!node || !container) {
-               throw invalid_iterator();
-           }
-           const_iterator tmp = *this;
-           node = findInorderSuccessor(node);
-           return tmp;
+       y->left = x;
+       x->right = T2;
+
+       if (T2) T2->setParent(x);
+       y->setParent(x->parent());
+       replaceChild(x->parent(), x, y);
+       x->setParent(y);
+       pull(x);
+       pull(y);
+
+       return y;
+   }
+
+   // Single rotation at a right-heavy x whose right child is not left-heavy.
+   static NodeBase* rotateLeft(NodeBase *x) {
+       NodeBase *z = leftRotate(x);
+       if (z->balance() == 0) {
+           x->setBalance(1);
+           z->setBalance(-1);
+       } else {
+           x->setBalance(0);
+           z->setBalance(0);
        }
+       return z;
+   }
 
-       const_iterator &operator++() {
-           if (!node || !container) {
-               throw invalid_iterator();
-           }
-           node = findInorderSuccessor(node);
-           return *this;
+   static NodeBase* rotateRight(NodeBase *x) {
+       NodeBase *z = rightRotate(x);
+       if (z->balance() == 0) {
+           x->setBalance(-1);
+           z->setBalance(1);
+       } else {
+           x->setBalance(0);
+           z->setBalance(0);
        }
+       return z;
+   }
 
-       const_iterator operator--(int) {
-           if (!container) {
-               throw invalid_iterator();
-           }
-           const_iterator tmp = *this;
-           if (!node) {
-               node = container->root;
-               if (node) {
-                   while (node->right) {
-                       node = node->right;
+   // Double rotation at a right-heavy x whose right child is left-heavy.
+   static NodeBase* rotateRightLeft(NodeBase *x) {
+       NodeBase *z = x->right;
+       NodeBase *y = z->left;
+       int b = y->balance();
+       rightRotate(z);
+       leftRotate(x);
+       x->setBalance(b > 0 ? -1 : 0);
+       z->setBalance(b < 0 ? 1 : 0);
+       y->setBalance(0);
+       return y;
+   }
+
+   static NodeBase* rotateLeftRight(NodeBase *x) {
+       NodeBase *z = x->left;
+       NodeBase *y = z->right;
+       int b = y->balance();
+       leftRotate(z);
+       rightRotate(x);
+       x->setBalance(b < 0 ? 1 : 0);
+       z->setBalance(b > 0 ? -1 : 0);
+       y->setBalance(0);
+       return y;
+   }
+
+   // Walks up from a subtree that just grew by one level. Stops at the first
+   // ancestor whose height stays the same, which includes the one a
+   // rotation is applied to.
+   void rebalanceAfterInsert(NodeBase *child) {
+       for (NodeBase *p = child->parent(); p != &header; child = p, p = p->parent()) {
+           int b = p->balance();
+           if (child == p->left) {
+               if (b > 0) {
+                   p->setBalance(0);
+                   return;
+               }
+               if (b == 0) {
+                   p->setBalance(-1);
+                   continue;
+               }
+               if (child->balance() > 0) {
+                   rotateLeftRight(p);
+               } else {
+                   rotateRight(p);
+               }
+               return;
+           } else {
+               if (b < 0) {
+                   p->setBalance(0);
+                   return;
+               }
+               if (b == 0) {
+                   p->setBalance(1);
+                   continue;
+               }
+               if (child->balance() < 0) {
+                   rotateRightLeft(p);
+               } else {
+                   rotateLeft(p);
+               }
+               return;
+           }
+       }
+   }
+
+   // Walks up from `p`, whose left (fromLeft) or right subtree just shrank
+   // by one level, and stops as soon as a subtree keeps its height.
+   void rebalanceAfterErase(NodeBase *p, bool fromLeft) {
+       while (p != &header) {
+           NodeBase *g = p->parent();
+           bool isLeft = g->left == p;
+           int b = p->balance();
+           if (fromLeft) {
+               if (b == 0) {
+                   p->setBalance(1);
+                   return;
+               }
+               if (b < 0) {
+                   p->setBalance(0);
+               } else if (p->right->balance() < 0) {
+                   rotateRightLeft(p);
+               } else {
+                   bool sameHeight = p->right->balance() == 0;
+                   rotateLeft(p);
+                   if (sameHeight) return;
+               }
+           } else {
+               if (b == 0) {
+                   p->setBalance(-1);
+                   return;
+               }
+               if (b > 0) {
+                   p->setBalance(0);
+               } else if (p->left->balance() > 0) {
+                   rotateLeftRight(p);
+               } else {
+                   bool sameHeight = p->left->balance() == 0;
+                   rotateRight(p);
+                   if (sameHeight) return;
+               }
+           }
+           fromLeft = isLeft;
+           p = g;
+       }
+   }
+
+   // One descent with a single comparison per level: the last node we turned
+   // right at is the only one whose key can equal `key`, so equality is
+   // checked once at the bottom. On a miss `parent`/`toLeft` describe where
+   // the new node has to be attached.
+   //
+   // Keys beyond the current maximum or minimum (timestamps, sequence
+   // numbers) go straight to rightmost/leftmost. The comparison against the
+   // root picks which extreme to test, so an append or prepend costs two
+   // comparisons and any other insert pays one extra.
+   Node* findInsertPos(const Key &key, NodeBase *&parent, bool &toLeft) const {
+       Probe<Key> probe(*this, key);
+       NodeBase *current = root();
+       NodeBase *candidate = nullptr;
+       parent = endNode();
+       toLeft = true;
+       if (current) {
+           parent = current;
+           if (probe.before(current)) {
+               if (probe.before(leftmost)) {
+                   parent = leftmost;
+                   return nullptr;
+               }
+               current = current->left;
+           } else {
+               toLeft = false;
+               if (probe.after(rightmost)) {
+                   parent = rightmost;
+                   return nullptr;
+               }
+               candidate = current;
+               current = current->right;
+           }
+       }
+       while (current) {
+           parent = current;
+           if (probe.before(current)) {
+               toLeft = true;
+               current = current->left;
+           } else {
+               toLeft = false;
+               candidate = current;
+               current = current->right;
+           }
+       }
+       if (candidate && !probe.after(candidate)) {
+           return asNode(candidate);
+       }
+       return nullptr;
+   }
+
+   // findInsertPos for a caller walking keys in increasing order. `finger`
+   // is a node whose key is not greater than `key`, or null. Its subtree
+   // already has a lower bound below `key`, so we only climb until some
+   // ancestor bounds `key` from above and descend from there: k increasing
+   // keys cost O(k log(n/k)) comparisons instead of O(k log n).
+   Node* findInsertPosFrom(NodeBase *finger, const Key &key, NodeBase *&parent, bool &toLeft) const {
+       Probe<Key> probe(*this, key);
+       if (!finger) {
+           return findInsertPos(key, parent, toLeft);
+       }
+       NodeBase *current = finger;
+       for (NodeBase *p = current->parent(); p != &header; current = p, p = p->parent()) {
+           if (current == p->left && probe.before(p)) break;
+       }
+       NodeBase *candidate = nullptr;
+       while (current) {
+           parent = current;
+           if (probe.before(current)) {
+               toLeft = true;
+               current = current->left;
+           } else {
+               toLeft = false;
+               candidate = current;
+               current = current->right;
+           }
+       }
+       if (candidate && !probe.after(candidate)) {
+           return asNode(candidate);
+       }
+       return nullptr;
+   }
+
+   Node* attachNode(NodeBase *parent, bool toLeft, Node *node) {
+       pushPath(parent);
+       node->setParent(parent);
+       if (toLeft) {
+           parent->left = node;
+           if (parent == leftmost) leftmost = node;
+       } else {
+           parent->right = node;
+       }
+       if (parent == &header || (!toLeft && parent == rightmost)) {
+           rightmost = node;
+       }
+       mapSize++;
+       pullPath(node);
+       rebalanceAfterInsert(node);
+       return node;
+   }
+
+   static NodeBase* findMin(NodeBase *node) {
+       while (node->left) {
+           node = node->left;
+       }
+       return node;
+   }
+
+   static NodeBase* findMax(NodeBase *node) {
+       while (node->right) {
+           node = node->right;
+       }
+       return node;
+   }
+
+   static NodeBase* findInorderSuccessor(NodeBase *n) {
+       if (n->right) {
+           return findMin(n->right);
+       }
+
+       NodeBase *p = n->parent();
+       while (p && n == p->right) {
+           n = p;
+           p = p->parent();
+       }
+       return p;
+   }
+
+   static NodeBase* findInorderPredecessor(NodeBase *n) {
+       if (n->left) {
+           return findMax(n->left);
+       }
+
+       NodeBase *p = n->parent();
+       while (p && n == p->left) {
+           n = p;
+           p = p->parent();
+       }
+       return p;
+   }
+
+   // Like findInsertPos, but first tries to place `key` right next to `hint`.
+   // If `key` belongs between the hint and its in-order neighbour, one of the
+   // two has a free child slot on the facing side, so the node can be
+   // attached there without descending from the root. Otherwise this falls
+   // back to findInsertPos. A null hint always falls back.
+   Node* findHintPos(NodeBase *hint, const Key &key, NodeBase *&parent, bool &toLeft) const {
+       Probe<Key> probe(*this, key);
+       if (!hint || mapSize == 0) {
+           return findInsertPos(key, parent, toLeft);
+       }
+       if (hint == endNode()) {
+           if (probe.after(rightmost)) {
+               parent = rightmost;
+               toLeft = false;
+               return nullptr;
+           }
+           return findInsertPos(key, parent, toLeft);
+       }
+       if (probe.before(hint)) {
+           if (hint == leftmost) {
+               parent = leftmost;
+               toLeft = true;
+               return nullptr;
+           }
+           NodeBase *before = findInorderPredecessor(hint);
+           if (probe.after(before)) {
+               if (!before->right) {
+                   parent = before;
+                   toLeft = false;
+               } else {
+                   parent = hint;
+                   toLeft = true;
+               }
+               return nullptr;
+           }
+           return findInsertPos(key, parent, toLeft);
+       }
+       if (probe.after(hint)) {
+           if (hint == rightmost) {
+               parent = rightmost;
+               toLeft = false;
+               return nullptr;
+           }
+           NodeBase *after = findInorderSuccessor(hint);
+           if (probe.before(after)) {
+               if (!hint->right) {
+                   parent = hint;
+                   toLeft = false;
+               } else {
+                   parent = after;
+                   toLeft = true;
+               }
+               return nullptr;
+           }
+           return findInsertPos(key, parent, toLeft);
+       }
+       return asNode(hint);
+   }
+
+   // Unlinks `node` and rebalances. A node with two children is replaced by
+   // its in-order successor, which is relinked rather than copied, so no
+   // other node changes its key, value or address.
+   void eraseNode(Node *node) {
+       pushPath(node->left && node->right ? findMin(node->right) : node);
+       if (node == leftmost) {
+           leftmost = node->right ? findMin(node->right) : node->parent();
+       }
+       if (node == rightmost) {
+           rightmost = node->left ? findMax(node->left) : node->parent();
+       }
+
+       NodeBase *retraceFrom;
+       bool fromLeft;
+       if (node->left && node->right) {
+           NodeBase *succ = findMin(node->right);
+           if (succ != node->right) {
+               retraceFrom = succ->parent();
+               fromLeft = true;
+               retraceFrom->left = succ->right;
+               if (succ->right) succ->right->setParent(retraceFrom);
+               succ->right = node->right;
+               node->right->setParent(succ);
+           } else {
+               retraceFrom = succ;
+               fromLeft = false;
+           }
+           succ->left = node->left;
+           node->left->setParent(succ);
+           succ->setParent(node->parent());
+           succ->setBalance(node->balance());
+           replaceChild(node->parent(), node, succ);
+       } else {
+           NodeBase *child = node->left ? node->left : node->right;
+           retraceFrom = node->parent();
+           fromLeft = retraceFrom->left == node;
+           if (child) child->setParent(retraceFrom);
+           replaceChild(retraceFrom, node, child);
+       }
+       dropNode(node);
+       mapSize--;
+       pullPath(retraceFrom);
+       rebalanceAfterErase(retraceFrom, fromLeft);
+   }
+
+   // Runs the element destructors of a subtree without giving the memory
+   // back; the caller releases the whole pool afterwards.
+   void destroyTree(NodeBase *node) {
+       if (std::is_trivially_destructible<value_type>::value) return;
+       while (node) {
+           destroyTree(node->right);
+           NodeBase *left = node->left;
+           AllocTraits::destroy(pool.allocator(), &asNode(node)->data);
+           node = left;
+       }
+   }
+
+   // Destroys and frees a detached subtree; returns how many nodes it held.
+   size_t dropTree(NodeBase *node) {
+       size_t n = 0;
+       while (node) {
+           n += dropTree(node->right);
+           NodeBase *left = node->left;
+           dropNode(asNode(node));
+           node = left;
+           ++n;
+       }
+       return n;
+   }
+
+   // Split and join on detached subtrees. Heights are not stored: callers
+   // pass a subtree's height along and the children's heights follow from
+   // its balance factor. Both run in O(log n).
+
+   static int treeHeight(NodeBase *node) {
+       int h = 0;
+       for (; node; ++h) {
+           node = node->balance() < 0 ? node->left : node->right;
+       }
+       return h;
+   }
+
+   static int leftHeight(NodeBase *node, int h) {
+       return node->balance() > 0 ? h - 2 : h - 1;
+   }
+
+   static int rightHeight(NodeBase *node, int h) {
+       return node->balance() < 0 ? h - 2 : h - 1;
+   }
+
+   // Makes `left` and `right` the children of `node`; returns its height.
+   static int linkChildren(NodeBase *node, NodeBase *left, int hl, NodeBase *right, int hr) {
+       node->left = left;
+       if (left) left->setParent(node);
+       node->right = right;
+       if (right) right->setParent(node);
+       node->setBalance(hr - hl);
+       pull(node);
+       return (hl > hr ? hl : hr) + 1;
+   }
+
+   // Joins `left`, `mid` and `right`, whose keys are already in that order,
+   // into one AVL tree of height `h`. The shorter tree is hung off the spine
+   // of the taller one where the heights meet, then the way back up is
+   // rebalanced with at most one single or double rotation per level.
+   static NodeBase* joinTrees(NodeBase *left, int hl, NodeBase *mid, NodeBase *right, int hr, int &h) {
+       if (hl > hr + 1) return joinRight(left, hl, mid, right, hr, h);
+       if (hr > hl + 1) return joinLeft(left, hl, mid, right, hr, h);
+       h = linkChildren(mid, left, hl, right, hr);
+       return mid;
+   }
+
+   static NodeBase* joinRight(NodeBase *t, int ht, NodeBase *mid, NodeBase *right, int hr, int &h) {
+       push(t);
+       NodeBase *l = t->left, *c = t->right;
+       int hl = leftHeight(t, ht), hc = rightHeight(t, ht);
+       NodeBase *sub;
+       int hs;
+       if (hc <= hr + 1) {
+           hs = linkChildren(mid, c, hc, right, hr);
+           if (hs > hl + 1) {
+               push(c);
+               NodeBase *cl = c->left, *cr = c->right;
+               int hcl = leftHeight(c, hc), hcr = rightHeight(c, hc);
+               int ha = linkChildren(t, l, hl, cl, hcl);
+               int hb = linkChildren(mid, cr, hcr, right, hr);
+               h = linkChildren(c, t, ha, mid, hb);
+               return c;
+           }
+           sub = mid;
+       } else {
+           sub = joinRight(c, hc, mid, right, hr, hs);
+           if (hs > hl + 1) {
+               NodeBase *sl = sub->left, *sr = sub->right;
+               int hsl = leftHeight(sub, hs), hsr = rightHeight(sub, hs);
+               int ha = linkChildren(t, l, hl, sl, hsl);
+               h = linkChildren(sub, t, ha, sr, hsr);
+               return sub;
+           }
+       }
+       h = linkChildren(t, l, hl, sub, hs);
+       return t;
+   }
+
+   static NodeBase* joinLeft(NodeBase *left, int hl, NodeBase *mid, NodeBase *t, int ht, int &h) {
+       push(t);
+       NodeBase *c = t->left, *r = t->right;
+       int hc = leftHeight(t, ht), hr = rightHeight(t, ht);
+       NodeBase *sub;
+       int hs;
+       if (hc <= hl + 1) {
+           hs = linkChildren(mid, left, hl, c, hc);
+           if (hs > hr + 1) {
+               push(c);
+               NodeBase *cl = c->left, *cr = c->right;
+               int hcl = leftHeight(c, hc), hcr = rightHeight(c, hc);
+               int ha = linkChildren(mid, left, hl, cl, hcl);
+               int hb = linkChildren(t, cr, hcr, r, hr);
+               h = linkChildren(c, mid, ha, t, hb);
+               return c;
+           }
+           sub = mid;
+       } else {
+           sub = joinLeft(left, hl, mid, c, hc, hs);
+           if (hs > hr + 1) {
+               NodeBase *sl = sub->left, *sr = sub->right;
+               int hsl = leftHeight(sub, hs), hsr = rightHeight(sub, hs);
+               int hb = linkChildren(t, sr, hsr, r, hr);
+               h = linkChildren(sub, sl, hsl, t, hb);
+               return sub;
+           }
+       }
+       h = linkChildren(t, sub, hs, r, hr);
+       return t;
+   }
+
+   // Detaches the largest node of a non-empty subtree and returns it; the
+   // remaining nodes are rejoined into `rest`.
+   static NodeBase* splitLast(NodeBase *t, int ht, NodeBase *&rest, int &hrest) {
+       push(t);
+       if (!t->right) {
+           rest = t->left;
+           hrest = ht - 1;
+           return t;
+       }
+       NodeBase *r;
+       int hr;
+       NodeBase *last = splitLast(t->right, rightHeight(t, ht), r, hr);
+       rest = joinTrees(t->left, leftHeight(t, ht), t, r, hr, hrest);
+       return last;
+   }
+
+   // Concatenates two subtrees, every key of `left` below every key of `right`.
+   static NodeBase* joinTrees(NodeBase *left, int hl, NodeBase *right, int hr, int &h) {
+       if (!left) {
+           h = hr;
+           return right;
+       }
+       if (!right) {
+           h = hl;
+           return left;
+       }
+       NodeBase *rest;
+       int hrest;
+       NodeBase *mid = splitLast(left, hl, rest, hrest);
+       return joinTrees(rest, hrest, mid, right, hr, h);
+   }
+
+   // Splits a detached subtree into the keys below `key`, the node holding
+   // `key` (null if there is none) and the keys above it.
+   void splitAt(NodeBase *t, int ht, const Key &key, NodeBase *&left, int &hl,
+                NodeBase *&match, NodeBase *&right, int &hr) const {
+       if (!t) {
+           left = match = right = nullptr;
+           hl = hr = 0;
+           return;
+       }
+       push(t);
+       NodeBase *l = t->left, *r = t->right;
+       int htl = leftHeight(t, ht), htr = rightHeight(t, ht);
+       if (comp()(key, keyOf(t))) {
+           NodeBase *above;
+           int ha;
+           splitAt(l, htl, key, left, hl, match, above, ha);
+           right = joinTrees(above, ha, t, r, htr, hr);
+       } else if (comp()(keyOf(t), key)) {
+           NodeBase *below;
+           int hb;
+           splitAt(r, htr, key, below, hb, match, right, hr);
+           left = joinTrees(l, htl, t, below, hb, hl);
+       } else {
+           left = l;
+           hl = htl;
+           match = t;
+           right = r;
+           hr = htr;
+       }
+   }
+
+   // Installs a detached subtree as the whole tree.
+   void setRoot(NodeBase *node, size_t size) {
+       header.left = node;
+       mapSize = size;
+       if (node) {
+           node->setParent(&header);
+           leftmost = findMin(node);
+           rightmost = findMax(node);
+       } else {
+           leftmost = rightmost = &header;
+       }
+   }
+
+   // Ranges this short are erased node by node: the splits and the join
+   // touch about as many cold nodes as a few dozen single erases.
+   static const int shortEraseRange = 64;
+
+   // Erases [first, last); `last` may be the header. Longer ranges are cut
+   // out with two splits and one join, then freed in a single walk, for
+   // O(k + log n) in all.
+   void eraseRange(NodeBase *first, NodeBase *last) {
+       NodeBase *probe = first;
+       for (int i = 0; i < shortEraseRange && probe != last; ++i) {
+           probe = findInorderSuccessor(probe);
+       }
+       if (probe == last) {
+           while (first != last) {
+               NodeBase *next = findInorderSuccessor(first);
+               eraseNode(asNode(first));
+               first = next;
+           }
+           return;
+       }
+       if (first == leftmost && last == &header) {
+           clear();
+           return;
+       }
+       NodeBase *left, *match, *middle, *right;
+       int hl, hm, hr, h;
+       splitAt(root(), treeHeight(root()), keyOf(first), left, hl, match, middle, hm);
+       if (last == &header) {
+           size_t size = mapSize - 1 - dropTree(middle);
+           dropNode(asNode(first));
+           setRoot(left, size);
+           return;
+       }
+       splitAt(middle, hm, keyOf(last), middle, hm, match, right, hr);
+       size_t size = mapSize - 1 - dropTree(middle);
+       dropNode(asNode(first));
+       setRoot(joinTrees(left, hl, last, right, hr, h), size);
+   }
+
+   // Bound descents: one comparison per level, the header when no key
+   // qualifies.
+
+   // First key not less than `key`.
+   template<class K>
+   NodeBase* lowerBoundNode(const K &key) const {
+       Probe<K> probe(*this, key);
+       NodeBase *current = root(), *result = endNode();
+       while (current) {
+           if (probe.after(current)) {
+               current = current->right;
+           } else {
+               result = current;
+               current = current->left;
+           }
+       }
+       return result;
+   }
+
+   // First key greater than `key`.
+   template<class K>
+   NodeBase* upperBoundNode(const K &key) const {
+       Probe<K> probe(*this, key);
+       NodeBase *current = root(), *result = endNode();
+       while (current) {
+           if (probe.before(current)) {
+               result = current;
+               current = current->left;
+           } else {
+               current = current->right;
+           }
+       }
+       return result;
+   }
+
+   // Last key not greater than `key`.
+   template<class K>
+   NodeBase* floorNode(const K &key) const {
+       Probe<K> probe(*this, key);
+       NodeBase *current = root(), *result = endNode();
+       while (current) {
+           if (probe.before(current)) {
+               current = current->left;
+           } else {
+               result = current;
+               current = current->right;
+           }
+       }
+       return result;
+   }
+
+   // lower_bound, then one more comparison decides whether it holds `key`.
+   template<class K>
+   NodeBase* equalRangeEnd(NodeBase *lower, const K &key) const {
+       if (lower != &header && !comp()(key, keyOf(lower))) {
+           return lower == rightmost ? endNode() : findInorderSuccessor(lower);
+       }
+       return lower;
+   }
+
+   // Elements before `pos`: read off the subtree sizes when the policy
+   // keeps them, otherwise counted from whichever end is closer.
+   static const bool countsSubtrees = detail::counts_subtrees<AugmentData>::value;
+
+   static size_t subtreeSize(const NodeBase *node) {
+       return node ? node->size : 0;
+   }
+
+   // Position of `pos` in key order; the header's is size().
+   size_t indexOf(NodeBase *pos) const {
+       if (pos == &header) return mapSize;
+       size_t index = subtreeSize(pos->left);
+       for (NodeBase *p = pos->parent(); p != &header; pos = p, p = p->parent()) {
+           if (pos == p->right) index += subtreeSize(p->left) + 1;
+       }
+       return index;
+   }
+
+   NodeBase* nodeAt(size_t index) const {
+       NodeBase *current = root();
+       while (current) {
+           size_t leftSize = subtreeSize(current->left);
+           if (index < leftSize) {
+               current = current->left;
+           } else if (index == leftSize) {
+               return current;
+           } else {
+               index -= leftSize + 1;
+               current = current->right;
+           }
+       }
+       return endNode();
+   }
+
+   size_t countBefore(NodeBase *pos) const {
+       return countBefore(pos, std::integral_constant<bool, countsSubtrees>());
+   }
+
+   size_t countBefore(NodeBase *pos, std::true_type) const {
+       return indexOf(pos);
+   }
+
+   size_t countBefore(NodeBase *pos, std::false_type) const {
+       NodeBase *front = leftmost, *back = endNode();
+       for (size_t steps = 0;; ++steps) {
+           if (front == pos) return steps;
+           if (back == pos) return mapSize - steps;
+           front = findInorderSuccessor(front);
+           back = findInorderPredecessor(back);
+       }
+   }
+
+   // Set operations on detached trees: `t1` belongs to this map and is
+   // split by the keys of `t2`, whose structure drives the recursion and
+   // which is only read unless noted. Both
+   // trees stay balanced throughout, which bounds the work by
+   // O(m log(n/m + 1)) for sizes m <= n.
+
+   struct KeepMine {
+       void operator()(T &, const T &) const {}
+   };
+
+   // Every node of `t2` must already belong to this map's pool; nodes
+   // matching a key of `t1` are resolved into it and dropped.
+   template<class Resolve>
+   NodeBase* uniteTrees(NodeBase *t1, int h1, NodeBase *t2, int h2,
+                        Resolve &resolve, size_t &matches, int &h) {
+       if (!t2) {
+           h = h1;
+           return t1;
+       }
+       if (!t1) {
+           h = h2;
+           return t2;
+       }
+       push(t2);
+       NodeBase *l2 = t2->left, *r2 = t2->right;
+       int hl2 = leftHeight(t2, h2), hr2 = rightHeight(t2, h2);
+       NodeBase *l1, *m1, *r1;
+       int hl1, hr1;
+       splitAt(t1, h1, keyOf(t2), l1, hl1, m1, r1, hr1);
+       NodeBase *mid = t2;
+       if (m1) {
+           const T &theirs = asNode(t2)->data.second;
+           resolve(asNode(m1)->data.second, theirs);
+           dropNode(asNode(t2));
+           mid = m1;
+           ++matches;
+       }
+       int hl, hr;
+       NodeBase *l = uniteTrees(l1, hl1, l2, hl2, resolve, matches, hl);
+       NodeBase *r = uniteTrees(r1, hr1, r2, hr2, resolve, matches, hr);
+       return joinTrees(l, hl, mid, r, hr, h);
+   }
+
+   template<class Resolve>
+   NodeBase* intersectTrees(NodeBase *t1, int h1, NodeBase *t2, int h2,
+                            Resolve &resolve, size_t &kept, int &h) {
+       if (!t1) {
+           h = 0;
+           return nullptr;
+       }
+       if (!t2) {
+           dropTree(t1);
+           h = 0;
+           return nullptr;
+       }
+       push(t2);
+       NodeBase *l1, *m1, *r1;
+       int hl1, hr1;
+       splitAt(t1, h1, keyOf(t2), l1, hl1, m1, r1, hr1);
+       int hl, hr;
+       NodeBase *l = intersectTrees(l1, hl1, t2->left, leftHeight(t2, h2),
+                                    resolve, kept, hl);
+       NodeBase *r = intersectTrees(r1, hr1, t2->right, rightHeight(t2, h2),
+                                    resolve, kept, hr);
+       if (m1) {
+           const T &theirs = asNode(t2)->data.second;
+           resolve(asNode(m1)->data.second, theirs);
+           ++kept;
+           return joinTrees(l, hl, m1, r, hr, h);
+       }
+       return joinTrees(l, hl, r, hr, h);
+   }
+
+   NodeBase* subtractTrees(NodeBase *t1, int h1, NodeBase *t2, int h2, size_t &removed, int &h) {
+       if (!t1 || !t2) {
+           h = t1 ? h1 : 0;
+           return t1;
+       }
+       NodeBase *l1, *m1, *r1;
+       int hl1, hr1;
+       splitAt(t1, h1, keyOf(t2), l1, hl1, m1, r1, hr1);
+       int hl, hr;
+       NodeBase *l = subtractTrees(l1, hl1, t2->left, leftHeight(t2, h2), removed, hl);
+       NodeBase *r = subtractTrees(r1, hr1, t2->right, rightHeight(t2, h2), removed, hr);
+       if (m1) {
+           dropNode(asNode(m1));
+           ++removed;
+       }
+       return joinTrees(l, hl, r, hr, h);
+   }
+
+   // Takes all of `other`'s nodes and pool blocks; allocators must compare
+   // equal. Returns other's detached tree.
+   NodeBase* adoptTree(map &other, int &h, size_t &size) {
+       NodeBase *t = other.root();
+       h = treeHeight(t);
+       size = other.mapSize;
+       other.resetHeader();
+       pool.adopt(other.pool);
+       return t;
+   }
+
+   // Once one side is this many times larger than the other, the set
+   // operations walk the smaller one in key order and look each key up in
+   // the larger instead of splitting and joining both trees. Keys that
+   // compare in one instruction (detail::branchless_search) are looked up
+   // from the root, where findNode() is fastest. Other keys use a finger
+   // search from the previous match, which saves comparisons, until the
+   // matches lie fingerSearchRatio elements apart and descents from the
+   // root are cheaper again. The ratios are the crossovers bench/set_ops.cpp
+   // measured for int and std::string keys at 1e5 to 1e6 elements.
+   static const bool cheapKeys = detail::branchless_search<Compare, Key, Key>::value;
+   static const size_t lopsidedUnionRatio = cheapKeys ? 3 : 2;
+   static const size_t lopsidedIntersectionRatio = 8;
+   static const size_t lopsidedDifferenceRatio = cheapKeys ? 6 : 2;
+   static const size_t fingerSearchRatio = 16;
+
+   static bool walkWithFinger(size_t smaller, size_t larger) {
+       return !cheapKeys && larger < smaller * fingerSearchRatio;
+   }
+
+   // The lookups of those walks; `finger` is the previous match or
+   // insertion point, or null to descend from the root.
+   Node* walkFind(NodeBase *finger, const Key &key, NodeBase *&parent, bool &toLeft) const {
+       return finger ? findInsertPosFrom(finger, key, parent, toLeft) : findInsertPos(key, parent, toLeft);
+   }
+
+   Node* walkFind(NodeBase *finger, const Key &key) const {
+       NodeBase *parent;
+       bool toLeft;
+       return finger ? findInsertPosFrom(finger, key, parent, toLeft) : findNode(key);
+   }
+
+   template<class Resolve>
+   void uniteAdopted(map &other, Resolve &resolve) {
+       bool lopsided = other.mapSize * lopsidedUnionRatio <= mapSize;
+       int h1 = treeHeight(root()), h2, h;
+       size_t size2, matches = 0;
+       NodeBase *t2 = adoptTree(other, h2, size2);
+       if (!lopsided) {
+           NodeBase *t = uniteTrees(root(), h1, t2, h2, resolve, matches, h);
+           setRoot(t, mapSize + size2 - matches);
+           return;
+       }
+       NodeBase chain;
+       chainTree(t2, &chain)->right = nullptr;
+       bool fingers = walkWithFinger(size2, mapSize);
+       NodeBase *finger = nullptr;
+       for (NodeBase *node = chain.right; node;) {
+           NodeBase *next = node->right;
+           NodeBase *parent;
+           bool toLeft;
+           Node *match = walkFind(finger, keyOf(node), parent, toLeft);
+           if (match) {
+               pushPath(match);
+               const T &theirs = asNode(node)->data.second;
+               resolve(match->data.second, theirs);
+               pullPath(match);
+               dropNode(asNode(node));
+           } else {
+               node->left = node->right = nullptr;
+               node->setBalance(0);
+               match = attachNode(parent, toLeft, asNode(node));
+           }
+           if (fingers) finger = match;
+           node = next;
+       }
+   }
+
+   static const value_type &elementOf(NodeBase *node, std::false_type) {
+       return asNode(node)->data;
+   }
+
+   static value_type &&elementOf(NodeBase *node, std::true_type) {
+       return std::move(asNode(node)->data);
+   }
+
+   template<class Move>
+   NodeBase* copyNode(NodeBase *other, NodeBase *parent, Move move) {
+       if (!other) return nullptr;
+       Node *node = createNode(elementOf(other, move));
+       static_cast<AugmentData&>(*node) = static_cast<const AugmentData&>(*other);
+       node->setParent(parent);
+       node->setBalance(other->balance());
+       node->left = copyNode(other->left, node, move);
+       node->right = copyNode(other->right, node, move);
+       pull(node);
+       return node;
+   }
+
+   // Rebuilds other's tree, shape included, in this empty map. With
+   // std::true_type the elements are moved out of `other`, which the
+   // caller then clears.
+   template<class Move = std::false_type>
+   void copyTree(const map &other, Move move = Move()) {
+       header.left = copyNode(other.root(), &header, move);
+       mapSize = other.mapSize;
+       if (header.left) {
+           leftmost = findMin(header.left);
+           rightmost = findMax(header.left);
+       }
+   }
+
+   // Bulk construction. Nodes are first chained in input order through
+   // `right`; the chain is sorted only if the input was not, and then turned
+   // into a tree in one pass.
+
+   void dropChain(NodeBase *node) {
+       while (node) {
+           NodeBase *next = node->right;
+           dropNode(asNode(node));
+           node = next;
+       }
+   }
+
+   // Builds a balanced tree in this map's pool from the elements of the `n`
+   // chained nodes, moving them unless their move may throw and they can be
+   // copied. On failure the new nodes are freed and the chain is untouched.
+   NodeBase* relocateChain(NodeBase *chain, size_t n) {
+       NodeBase copies;
+       NodeBase *tail = &copies;
+       try {
+           for (NodeBase *node = chain; node; node = node->right) {
+               tail = tail->right = createNode(std::move_if_noexcept(asNode(node)->data));
+           }
+       } catch (...) {
+           tail->right = nullptr;
+           dropChain(copies.right);
+           throw;
+       }
+       tail->right = nullptr;
+       NodeBase *head = copies.right;
+       return buildBalanced(head, n);
+   }
+
+   // Stable merge sort of the first `n` links of the chain at `head`, which
+   // holds nodes or batch ops; advances `head` past them and returns them
+   // sorted.
+   template<class Link>
+   Link* sortChain(Link *&head, size_t n) {
+       if (n == 1) {
+           Link *node = head;
+           head = head->right;
+           node->right = nullptr;
+           return node;
+       }
+       Link *a = sortChain(head, n / 2);
+       Link *b = sortChain(head, n - n / 2);
+       Link merged;
+       Link *tail = &merged;
+       while (a && b) {
+           if (comp()(keyOf(b), keyOf(a))) {
+               tail->right = b;
+               b = b->right;
+           } else {
+               tail->right = a;
+               a = a->right;
+           }
+           tail = tail->right;
+       }
+       tail->right = a ? a : b;
+       return merged.right;
+   }
+
+   // Drops every node whose key equals its predecessor's, so the first
+   // occurrence wins as it would with repeated insert(). Returns the length.
+   size_t uniqueChain(NodeBase *head) {
+       size_t n = 1;
+       for (NodeBase *prev = head, *node = head->right; node; node = prev->right) {
+           if (comp()(keyOf(prev), keyOf(node))) {
+               prev = node;
+               ++n;
+           } else {
+               prev->right = node->right;
+               dropNode(asNode(node));
+           }
+       }
+       return n;
+   }
+
+   static int bitWidth(size_t n) {
+       int w = 0;
+       for (; n; n >>= 1) ++w;
+       return w;
+   }
+
+   // Takes `n` sorted nodes from the chain. The subtrees differ in size by
+   // at most one, so a subtree of k nodes has height bitWidth(k) and the
+   // balance factors follow from the sizes alone.
+   static NodeBase* buildBalanced(NodeBase *&head, size_t n) {
+       if (n == 0) return nullptr;
+       size_t leftSize = (n - 1) / 2, rightSize = n - 1 - leftSize;
+       NodeBase *left = buildBalanced(head, leftSize);
+       NodeBase *node = head;
+       head = head->right;
+       node->left = left;
+       if (left) left->setParent(node);
+       node->right = buildBalanced(head, rightSize);
+       if (node->right) node->right->setParent(node);
+       node->setBalance(bitWidth(rightSize) - bitWidth(leftSize));
+       pull(node);
+       return node;
+   }
+
+   // The map must be empty. Strictly increasing input costs n - 1
+   // comparisons on top of the linear build.
+   template<class InputIt>
+   void buildFrom(InputIt first, InputIt last) {
+       NodeBase *head = nullptr, *tail = nullptr;
+       size_t n = 0;
+       bool ordered = true, strict = true;
+       try {
+           for (; first != last; ++first) {
+               Node *node = createNode(*first);
+               if (tail) {
+                   tail->right = node;
+                   if (strict && !comp()(keyOf(tail), keyOf(node))) {
+                       strict = false;
+                       ordered = !comp()(keyOf(node), keyOf(tail));
+                   } else if (!strict && ordered && comp()(keyOf(node), keyOf(tail))) {
+                       ordered = false;
                    }
+               } else {
+                   head = node;
+               }
+               tail = node;
+               ++n;
+           }
+       } catch (...) {
+           dropChain(head);
+           throw;
+       }
+       if (n == 0) return;
+       if (!ordered) {
+           head = sortChain(head, n);
+       }
+       if (!strict) {
+           n = uniqueChain(head);
+       }
+       setRoot(buildBalanced(head, n), n);
+   }
+
+   // apply_batch() merges the ops into the band of keys they span, cut out
+   // and rebuilt, once the batch has at least one op per this many elements
+   // of the band. These are the crossovers bench/apply_batch.cpp measured
+   // against sorted descents for int and std::string keys, maps of 1e5 to
+   // 1e6 elements and bands from a hundredth of the map to all of it.
+   static const size_t denseBatchRatio = cheapKeys ? 4 : 8;
+
+   // apply_batch() chains its ops through `right` to sort them with
+   // sortChain(), in scratch space from the map's allocator.
+   struct BatchLink {
+       const batch_op *op;
+       BatchLink *right;
+   };
+
+   typedef typename AllocTraits::template rebind_alloc<BatchLink> BatchAllocator;
+   typedef typename AllocTraits::template rebind_traits<BatchLink> BatchTraits;
+
+   static const Key& keyOf(const BatchLink *link) {
+       return link->op->key;
+   }
+
+   // Applies one op to the node holding its key (null if absent).
+   void applyToChainNode(Node *&node, const batch_op &op) {
+       if (op.kind == batch_op::erase) {
+           if (node) {
+               dropNode(node);
+               node = nullptr;
+           }
+       } else if (!node) {
+           node = createNode(op.key, op.value);
+       } else if (op.kind == batch_op::assign) {
+           node->data.second = op.value;
+       }
+   }
+
+   // Sparse batches: one descent per op, from the previous op's node when
+   // walkWithFinger() says so and from the root otherwise.
+   void applySparse(const BatchLink *ops, bool fingers) {
+       NodeBase *finger = nullptr;
+       for (; ops; ops = ops->right) {
+           const batch_op &op = *ops->op;
+           NodeBase *parent;
+           bool toLeft;
+           Node *node = walkFind(finger, op.key, parent, toLeft);
+           if (op.kind == batch_op::erase) {
+               if (node) {
+                   NodeBase *before = fingers ? findInorderPredecessor(node) : &header;
+                   finger = before == &header ? nullptr : before;
+                   eraseNode(node);
+               }
+               continue;
+           }
+           if (!node) {
+               node = attachNode(parent, toLeft, createNode(op.key, op.value));
+           } else if (op.kind == batch_op::assign) {
+               pushPath(node);
+               node->data.second = op.value;
+               pullPath(node);
+           }
+           if (fingers) finger = node;
+       }
+   }
+
+   // Links the tree's nodes in order through `right`, after `tail`.
+   static NodeBase* chainTree(NodeBase *node, NodeBase *tail) {
+       while (node) {
+           push(node);
+           tail = chainTree(node->left, tail);
+           tail->right = node;
+           tail = node;
+           node = node->right;
+       }
+       return tail;
+   }
+
+   // The fewest nodes an AVL tree of height `h` can hold.
+   static size_t minTreeSize(int h) {
+       size_t shorter = 0, taller = h > 0 ? 1 : 0;
+       for (; h > 1; --h) {
+           size_t next = shorter + taller + 1;
+           shorter = taller;
+           taller = next;
+       }
+       return taller;
+   }
+
+   // Nodes in a detached subtree, counted up to one past `limit`.
+   static size_t countUpTo(NodeBase *node, size_t, std::true_type) {
+       return subtreeSize(node);
+   }
+
+   static size_t countUpTo(NodeBase *node, size_t limit, std::false_type) {
+       size_t n = 0;
+       for (; node && n <= limit; node = node->right) {
+           n += countUpTo(node->left, limit - n, std::false_type()) + 1;
+       }
+       return n;
+   }
+
+   // Dense batches: flatten the detached subtree `tree` of `n` nodes, merge
+   // the ops in and rebuild it. `tree` and `n` describe the result, also
+   // when an op throws.
+   void mergeBatch(NodeBase *&tree, size_t &n, const BatchLink *ops) {
+       NodeBase chain, merged;
+       chainTree(tree, &chain)->right = nullptr;
+       NodeBase *node = chain.right, *tail = &merged;
+       Node *current = nullptr;
+       n = 0;
+       try {
+           while (ops) {
+               const Key &key = ops->op->key;
+               while (node && comp()(keyOf(node), key)) {
+                   tail = tail->right = node;
+                   node = node->right;
+                   ++n;
+               }
+               current = nullptr;
+               if (node && !comp()(key, keyOf(node))) {
+                   current = asNode(node);
+                   node = node->right;
+               }
+               for (; ops && !comp()(key, ops->op->key); ops = ops->right) {
+                   applyToChainNode(current, *ops->op);
+               }
+               if (current) {
+                   tail = tail->right = current;
+                   current = nullptr;
+                   ++n;
                }
+           }
+       } catch (...) {
+           if (current) {
+               tail = tail->right = current;
+               ++n;
+           }
+           tree = rebuildFromChain(&merged, tail, node, n);
+           throw;
+       }
+       tree = rebuildFromChain(&merged, tail, node, n);
+   }
+
+   // The chain after `first` up to `tail` holds `n` sorted nodes, and `rest`
+   // is the untouched suffix; `n` comes back as the length of the whole.
+   static NodeBase* rebuildFromChain(NodeBase *first, NodeBase *tail, NodeBase *rest, size_t &n) {
+       for (; rest; rest = rest->right, ++n) {
+           tail = tail->right = rest;
+       }
+       tail->right = nullptr;
+       NodeBase *head = first->right;
+       return buildBalanced(head, n);
+   }
+
+   // Cuts out the keys in [first op, `last`] with two splits. A batch dense
+   // within that band is merged into it there, in O(band + k); otherwise
+   // the band goes back and the ops descend one by one. Either way the
+   // pieces are joined again in O(log n).
+   void applySorted(const BatchLink *ops, const Key &last, size_t count) {
+       NodeBase *left, *match, *band, *right;
+       int hl, hb, hr, h;
+       splitAt(root(), treeHeight(root()), keyOf(ops), left, hl, match, band, hb);
+       if (match) band = joinTrees(nullptr, 0, match, band, hb, hb);
+       splitAt(band, hb, last, band, hb, match, right, hr);
+       if (match) band = joinTrees(band, hb, match, nullptr, 0, hb);
+       // The band is counted as far as the dense and finger decisions need.
+       size_t dense = count * denseBatchRatio;
+       size_t limit = cheapKeys ? dense : count * fingerSearchRatio, spanned = minTreeSize(hb);
+       if (spanned <= limit) {
+           spanned = countUpTo(band, limit, std::integral_constant<bool, countsSubtrees>());
+       }
+       size_t outside = mapSize - spanned;
+       if (spanned > dense) {
+           NodeBase *lower = joinTrees(left, hl, band, hb, h);
+           setRoot(joinTrees(lower, h, right, hr, h), mapSize);
+           applySparse(ops, walkWithFinger(count, spanned));
+           return;
+       }
+       try {
+           mergeBatch(band, spanned, ops);
+       } catch (...) {
+           NodeBase *lower = joinTrees(left, hl, band, bitWidth(spanned), h);
+           setRoot(joinTrees(lower, h, right, hr, h), outside + spanned);
+           throw;
+       }
+       NodeBase *lower = joinTrees(left, hl, band, bitWidth(spanned), h);
+       setRoot(joinTrees(lower, h, right, hr, h), outside + spanned);
+   }
+
+   void resetHeader() {
+       header.left = nullptr;
+       leftmost = rightmost = &header;
+       mapSize = 0;
+   }
+
+   // Re-points the root at this map's header after the tree changed hands.
+   void adoptHeader() {
+       if (header.left) {
+           header.left->setParent(&header);
+       } else {
+           leftmost = rightmost = &header;
+       }
+   }
+
+   // Allocators that do not propagate on swap, such as
+   // polymorphic_allocator, need not be swappable at all.
+   void swapAllocators(map &other, std::true_type) {
+       using std::swap;
+       swap(pool.allocator(), other.pool.allocator());
+   }
+
+   void swapAllocators(map &, std::false_type) {}
+
+   // The same for assignment: only an allocator that propagates is assigned.
+   void assignAllocator(const map &other, std::true_type) {
+       pool.allocator() = other.pool.allocator();
+   }
+
+   void assignAllocator(const map &, std::false_type) {}
+
+   // Move assignment when other's nodes can always be taken over.
+   void moveAssign(map &other, std::true_type) {
+       assignAllocator(other, typename AllocTraits::propagate_on_container_move_assignment());
+       stealFrom(other);
+   }
+
+   // Otherwise only from an equal allocator; from a different one each
+   // element is moved into a node of this map's own.
+   void moveAssign(map &other, std::false_type) {
+       if (pool.allocator() == other.pool.allocator()) {
+           stealFrom(other);
+       } else {
+           copyTree(other, std::true_type());
+           other.clear();
+       }
+   }
+
+   // Takes over other's nodes and pool blocks; this map must be empty and
+   // its pool released, and the allocators must be interchangeable.
+   void stealFrom(map &other) {
+       pool.swap(other.pool);
+       header.left = other.header.left;
+       leftmost = other.leftmost;
+       rightmost = other.rightmost;
+       mapSize = other.mapSize;
+       adoptHeader();
+       other.resetHeader();
+   }
+
+   // Exact lookup with one comparator call per level: a three-way
+   // comparison when detail::three_way finds one, which can stop at the
+   // match, and otherwise a lower-bound descent whose last left turn is
+   // the only candidate, checked once at the bottom.
+   template<class K>
+   Node* findNode(const K &key) const {
+       return findNode(key, detail::three_way<Compare, K, Key>(), detail::branchless_search<Compare, K, Key>());
+   }
+
+   template<class K>
+   Node* findNode(const K &key, std::true_type, std::false_type) const {
+       Probe<K> probe(*this, key);
+       NodeBase *current = root();
+       while (current) {
+           push(current);
+           auto order = probe.order(current);
+           if (order < 0) {
+               current = current->left;
+           } else if (order > 0) {
+               current = current->right;
+           } else {
+               return asNode(current);
+           }
+       }
+       return nullptr;
+   }
+
+   template<class K>
+   Node* findNode(const K &key, std::false_type, std::false_type) const {
+       Probe<K> probe(*this, key);
+       NodeBase *current = root(), *candidate = nullptr;
+       while (current) {
+           push(current);
+           if (probe.after(current)) {
+               current = current->right;
            } else {
-               node = findInorderPredecessor(node);
+               candidate = current;
+               current = current->left;
+           }
+       }
+       if (candidate && !probe.before(candidate)) {
+           return asNode(candidate);
+       }
+       return nullptr;
+   }
+
+   // The same descent for arithmetic keys, written so that it compiles to
+   // conditional moves: the comparison indexes the child to follow instead
+   // of choosing a branch, which random lookups would mispredict half the
+   // time. Both children are prefetched while the node's key is compared,
+   // so whichever one is taken is already on its way in.
+   template<class K>
+   Node* findNode(const K &key, std::false_type, std::true_type) const {
+       static NodeBase *NodeBase::*const child[2] = {&NodeBase::left, &NodeBase::right};
+       NodeBase *current = root(), *candidate = nullptr;
+       while (current) {
+           push(current);
+           SJTU_MAP_PREFETCH(current->left);
+           SJTU_MAP_PREFETCH(current->right);
+           bool toRight = comp()(keyOf(current), key);
+           candidate = toRight ? candidate : current;
+           current = current->*child[toRight];
+       }
+       if (candidate && !comp()(key, keyOf(candidate))) {
+           return asNode(candidate);
+       }
+       return nullptr;
+   }
+
+   // find_batch() and count_batch() run this many searches side by side.
+   static const int batchWidth = 32;
+
+   // Looks up every key in [first, last) and calls emit with the node
+   // holding it, or null, in input order. Keys are taken batchWidth at a
+   // time and their descents advance one level per step in lockstep, each
+   // prefetching the node it goes to next, so the cache misses of
+   // different searches overlap instead of following one another.
+   template<class ForwardIt, class Emit>
+   void findBatch(ForwardIt first, ForwardIt last, Emit &emit) const {
+       typedef Probe<typename std::iterator_traits<ForwardIt>::value_type> BatchProbe;
+       // Probes hold references, so they are built in place, once per key.
+       union Lane {
+           BatchProbe probe;
+           Lane() {}
+       };
+       Lane lanes[batchWidth];
+       NodeBase *current[batchWidth], *candidate[batchWidth];
+       while (first != last) {
+           int n = 0;
+           for (; n < batchWidth && first != last; ++n, ++first) {
+               ::new (&lanes[n].probe) BatchProbe(*this, *first);
+               current[n] = root();
+               candidate[n] = nullptr;
+           }
+           for (bool active = root() != nullptr; active;) {
+               active = false;
+               for (int i = 0; i < n; ++i) {
+                   NodeBase *node = current[i];
+                   if (!node) continue;
+                   push(node);
+                   bool toRight = lanes[i].probe.after(node);
+                   candidate[i] = toRight ? candidate[i] : node;
+                   node = toRight ? node->right : node->left;
+                   SJTU_MAP_PREFETCH(node);
+                   current[i] = node;
+                   active |= node != nullptr;
+               }
+           }
+           for (int i = 0; i < n; ++i) {
+               NodeBase *node = candidate[i];
+               emit(node && !lanes[i].probe.before(node) ? node : nullptr);
+           }
+       }
+   }
+
+  public:
+   class const_iterator;
+   class iterator {
+      private:
+       map *container;
+       NodeBase *node;
+
+      public:
+       iterator() : container(nullptr), node(nullptr) {}
+
+       iterator(map *c, NodeBase *n) : container(c), node(n) {}
+
+       iterator(const iterator &other) : container(other.container), node(other.node) {}
+
+       iterator operator++(int) {
+           iterator tmp = *this;
+           ++*this;
+           return tmp;
+       }
+
+       iterator &operator++() {
+           if (!node || node == &container->header) {
+               throw invalid_iterator();
            }
+           // Stepping off the last element would otherwise climb to the root.
+           node = node == container->rightmost ? container->endNode() : findInorderSuccessor(node);
+           return *this;
+       }
+
+       iterator operator--(int) {
+           iterator tmp = *this;
+           --*this;
+           return tmp;
+       }
+
+       iterator &operator--() {
            if (!node) {
                throw invalid_iterator();
            }
+           NodeBase *prev = node == &container->header ?
+                            container->rightmost : findInorderPredecessor(node);
+           if (!prev || prev == &container->header) {
+               throw invalid_iterator();
+           }
+           node = prev;
+           return *this;
+       }
+
+       ElementRef &operator*() const {
+           if (!node || node == &container->header) {
+               throw invalid_iterator();
+           }
+           pushPath(node);
+           return asNode(node)->data;
+       }
+
+       bool operator==(const iterator &rhs) const {
+           return container == rhs.container && node == rhs.node;
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return container == rhs.container && node == rhs.node;
+       }
+
+       bool operator!=(const iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       ElementRef *operator->() const noexcept {
+           pushPath(node);
+           return &(asNode(node)->data);
+       }
+
+       friend class const_iterator;
+       friend class map;
+   };
+
+   class const_iterator {
+      private:
+       const map *container;
+       NodeBase *node;
+
+      public:
+       const_iterator() : container(nullptr), node(nullptr) {}
+
+       const_iterator(const map *c, NodeBase *n) : container(c), node(n) {}
+
+       const_iterator(const const_iterator &other) : container(other.container), node(other.node) {}
+
+       const_iterator(const iterator &other) : container(other.container), node(other.node) {}
+
+       const_iterator operator++(int) {
+           const_iterator tmp = *this;
+           ++*this;
            return tmp;
        }
 
-       const_iterator &operator--() {
-           if (!container) {
+       const_iterator &operator++() {
+           if (!node || node == &container->header) {
                throw invalid_iterator();
            }
+           // Stepping off the last element would otherwise climb to the root.
+           node = node == container->rightmost ? container->endNode() : findInorderSuccessor(node);
+           return *this;
+       }
+
+       const_iterator operator--(int) {
+           const_iterator tmp = *this;
+           --*this;
+           return tmp;
+       }
+
+       const_iterator &operator--() {
            if (!node) {
-               node = container->root;
-               if (node) {
-                   while (node->right) {
-                       node = node->right;
-                   }
-               }
-           } else {
-               node = findInorderPredecessor(node);
+               throw invalid_iterator();
            }
-           if (!node) {
+           NodeBase *prev = node == &container->header ?
+                            container->rightmost : findInorderPredecessor(node);
+           if (!prev || prev == &container->header) {
                throw invalid_iterator();
            }
+           node = prev;
            return *this;
        }
 
        const value_type &operator*() const {
-           if (!node) {
+           if (!node || node == &container->header) {
                throw invalid_iterator();
            }
-           return node->data;
+           pushPath(node);
+           return asNode(node)->data;
+       }
+
+       bool operator==(const iterator &rhs) const {
+           return container == rhs.container && node == rhs.node;
+       }
+
+       bool operator==(const const_iterator &rhs) const {
+           return container == rhs.container && node == rhs.node;
+       }
+
+       bool operator!=(const iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       bool operator!=(const const_iterator &rhs) const {
+           return !(*this == rhs);
+       }
+
+       const value_type *operator->() const noexcept {
+           pushPath(node);
+           return &(asNode(node)->data);
+       }
+
+       friend class map;
+   };
+
+  private:
+   // range_apply() for either overload: tags are pushed on the way down, so
+   // older ops reach every value before `op` does.
+   template<class K, class Op>
+   void applyRange(const K &lo, const K &hi, const Op &op) {
+       if (!comp()(lo, hi)) return;
+       NodeBase *top = root();
+       while (top) {
+           push(top);
+           if (comp()(keyOf(top), lo)) {
+               top = top->right;
+           } else if (!comp()(keyOf(top), hi)) {
+               top = top->left;
+           } else {
+               break;
+           }
+       }
+       if (!top) return;
+       top->apply(asNode(top)->data, op);
+       for (NodeBase *n = top->left; n;) {
+           push(n);
+           if (comp()(keyOf(n), lo)) {
+               n = n->right;
+           } else {
+               n->apply(asNode(n)->data, op);
+               tagSubtree(n->right, op);
+               n = n->left;
+           }
+       }
+       for (NodeBase *n = top->right; n;) {
+           push(n);
+           if (comp()(keyOf(n), hi)) {
+               n->apply(asNode(n)->data, op);
+               tagSubtree(n->left, op);
+               n = n->right;
+           } else {
+               n = n->left;
+           }
+       }
+   }
+
+   template<class F>
+   void updateNode(Node *node, F &f) {
+       pushPath(node);
+       try {
+           f(node->data.second);
+       } catch (...) {
+           pullPath(node);
+           throw;
+       }
+       pullPath(node);
+   }
+
+   size_t advancedIndex(const const_iterator &it, std::ptrdiff_t n) const {
+       static_assert(countsSubtrees, "advance() needs the sjtu::order_statistics policy");
+       if (!it.node || it.container != this) {
+           throw invalid_iterator();
+       }
+       std::ptrdiff_t index = (std::ptrdiff_t)indexOf(it.node) + n;
+       if (index < 0 || index > (std::ptrdiff_t)mapSize) {
+           throw index_out_of_bound();
        }
+       return (size_t)index;
+   }
+
+   // Iterators into another map are ignored rather than trusted.
+   NodeBase* hintNode(const const_iterator &hint) const {
+       return hint.container == this ? hint.node : nullptr;
+   }
 
-       bool operator==(const iterator &rhs) const {
-           return container == rhs.container && node == rhs.node;
+   template<class V>
+   pair<iterator, bool> insertValue(NodeBase *hint, V &&value) {
+       NodeBase *parent;
+       bool toLeft;
+       Node *node = findHintPos(hint, value.first, parent, toLeft);
+       if (node) {
+           return pair<iterator, bool>(iterator(this, node), false);
        }
+       node = attachNode(parent, toLeft, createNode(std::forward<V>(value)));
+       return pair<iterator, bool>(iterator(this, node), true);
+   }
 
-       bool operator==(const const_iterator &rhs) const {
-           return container == rhs.container && node == rhs.node;
+   template<class K, class... Args>
+   pair<iterator, bool> tryEmplace(K &&key, Args&&... args) {
+       NodeBase *parent;
+       bool toLeft;
+       Node *node = findInsertPos(key, parent, toLeft);
+       if (node) {
+           return pair<iterator, bool>(iterator(this, node), false);
        }
+       node = attachNode(parent, toLeft,
+                         createNode(std::piecewise_construct,
+                                    std::forward_as_tuple(std::forward<K>(key)),
+                                    std::forward_as_tuple(std::forward<Args>(args)...)));
+       return pair<iterator, bool>(iterator(this, node), true);
+   }
 
-       bool operator!=(const iterator &rhs) const {
-           return !(*this == rhs);
+   template<class K, class M>
+   pair<iterator, bool> insertOrAssign(K &&key, M &&obj) {
+       NodeBase *parent;
+       bool toLeft;
+       Node *node = findInsertPos(key, parent, toLeft);
+       if (node) {
+           pushPath(node);
+           node->data.second = std::forward<M>(obj);
+           pullPath(node);
+           return pair<iterator, bool>(iterator(this, node), false);
        }
+       node = attachNode(parent, toLeft, createNode(std::forward<K>(key), std::forward<M>(obj)));
+       return pair<iterator, bool>(iterator(this, node), true);
+   }
 
-       bool operator!=(const const_iterator &rhs) const {
-           return !(*this == rhs);
-       }
+  public:
+   map() : pool(Allocator()) {
+       resetHeader();
+   }
 
-       const value_type *operator->() const noexcept {
-           return &(node->data);
-       }
+   explicit map(const Compare &c, const Allocator &alloc = Allocator())
+       : detail::ebo_storage<Compare>(c), pool(alloc) {
+       resetHeader();
+   }
 
-       friend class map;
-   };
+   explicit map(const Allocator &alloc) : pool(alloc) {
+       resetHeader();
+   }
+
+   template<class InputIt>
+   map(InputIt first, InputIt last, const Compare &c = Compare(), const Allocator &alloc = Allocator())
+       : detail::ebo_storage<Compare>(c), pool(alloc) {
+       resetHeader();
+       buildFrom(first, last);
+   }
 
-   map() : root(nullptr), mapSize(0) {}
+   map(std::initializer_list<value_type> init, const Compare &c = Compare(),
+       const Allocator &alloc = Allocator())
+       : detail::ebo_storage<Compare>(c), pool(alloc) {
+       resetHeader();
+       buildFrom(init.begin(), init.end());
+   }
 
-   map(const map &other) : mapSize(0) {
-       root = copyNode(other.root);
-       mapSize = other.mapSize;
+   map(const map &other)
+       : detail::ebo_storage<Compare>(other.comp()),
+         pool(AllocTraits::select_on_container_copy_construction(other.pool.allocator())) {
+       resetHeader();
+       copyTree(other);
    }
 
    map &operator=(const map &other) {
        if (this != &other) {
            clear();
-           root = copyNode(other.root);
-           mapSize = other.mapSize;
+           this->get() = other.comp();
+           assignAllocator(other, typename AllocTraits::propagate_on_container_copy_assignment());
+           copyTree(other);
+       }
+       return *this;
+   }
+
+   // Moving never allocates, so containers of maps, such as std::vector,
+   // relocate them instead of copying every node.
+   map(map &&other) noexcept
+       : detail::ebo_storage<Compare>(other.comp()), pool(other.pool.allocator()) {
+       resetHeader();
+       stealFrom(other);
+   }
+
+   map &operator=(map &&other) noexcept(
+       AllocTraits::propagate_on_container_move_assignment::value ||
+       AllocTraits::is_always_equal::value) {
+       if (this != &other) {
+           clear();
+           this->get() = other.comp();
+           moveAssign(other, std::integral_constant<bool,
+               AllocTraits::propagate_on_container_move_assignment::value ||
+               AllocTraits::is_always_equal::value>());
        }
        return *this;
    }
 
+   // O(1). As with std::map, unless the allocator propagates on swap the
+   // two allocators must compare equal.
+   void swap(map &other) noexcept {
+       if (this == &other) return;
+       std::swap(this->get(), other.get());
+       swapAllocators(other, typename AllocTraits::propagate_on_container_swap());
+       pool.swap(other.pool);
+       std::swap(header.left, other.header.left);
+       std::swap(leftmost, other.leftmost);
+       std::swap(rightmost, other.rightmost);
+       std::swap(mapSize, other.mapSize);
+       adoptHeader();
+       other.adoptHeader();
+   }
+
+   friend void swap(map &a, map &b) noexcept {
+       a.swap(b);
+   }
+
    ~map() {
-       destroy(root);
+       destroyTree(root());
+   }
+
+   Compare key_comp() const {
+       return comp();
+   }
+
+   allocator_type get_allocator() const {
+       return pool.allocator();
+   }
+
+   MappedRef &at(const Key &key) {
+       return at<Key>(key);
    }
 
-   T &at(const Key &key) {
+   template<class K, class = EnableLookup<K> >
+   MappedRef &at(const K &key) {
        Node *node = findNode(key);
        if (!node) {
            throw index_out_of_bound();
@@ -552,6 +2598,11 @@ template<
    }
 
    const T &at(const Key &key) const {
+       return at<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   const T &at(const K &key) const {
        Node *node = findNode(key);
        if (!node) {
            throw index_out_of_bound();
@@ -559,14 +2610,12 @@ template<
        return node->data.second;
    }
 
-   T &operator[](const Key &key) {
-       Node *node = findNode(key);
-       if (!node) {
-           value_type tempValue(key, T());
-           root = insertNode(root, tempValue);
-           node = findNode(key);
-       }
-       return node->data.second;
+   MappedRef &operator[](const Key &key) {
+       return tryEmplace(key).first->second;
+   }
+
+   MappedRef &operator[](Key &&key) {
+       return tryEmplace(std::move(key)).first->second;
    }
 
    const T &operator[](const Key &key) const {
@@ -574,33 +2623,19 @@ template<
    }
 
    iterator begin() {
-       if (!root) {
-           return iterator(this, nullptr);
-       }
-       Node *node = root;
-       while (node->left) {
-           node = node->left;
-       }
-       return iterator(this, node);
+       return iterator(this, leftmost);
    }
 
    const_iterator cbegin() const {
-       if (!root) {
-           return const_iterator(this, nullptr);
-       }
-       Node *node = root;
-       while (node->left) {
-           node = node->left;
-       }
-       return const_iterator(this, node);
+       return const_iterator(this, leftmost);
    }
 
    iterator end() {
-       return iterator(this, nullptr);
+       return iterator(this, &header);
    }
 
    const_iterator cend() const {
-       return const_iterator(this, nullptr);
+       return const_iterator(this, endNode());
    }
 
    bool empty() const {
@@ -612,45 +2647,670 @@ template<
    }
 
    void clear() {
-       destroy(root);
-       root = nullptr;
-       mapSize = 0;
+       destroyTree(root());
+       pool.release();
+       resetHeader();
+   }
+
+   // Replaces the contents with [first, last). Sorted input is built in
+   // O(n); anything else is sorted first. On equal keys the first one wins.
+   template<class InputIt>
+   void assign_sorted(InputIt first, InputIt last) {
+       clear();
+       buildFrom(first, last);
+   }
+
+   // Applies `count` ops as if one by one in array order, but sorted by key
+   // (stably, so ops on one key keep their order) and merged in a single
+   // left-to-right pass. Batches that are large next to the band of keys
+   // they span rebuild just that band in O(band + k); smaller ones descend
+   // once per op. Sorting costs about as much as a descent that stays in
+   // cache, so this pays off on maps that do not fit there.
+   void apply_batch(const batch_op *ops, size_t count) {
+       if (count == 0) return;
+       BatchAllocator batchAlloc(pool.allocator());
+       BatchLink *links = BatchTraits::allocate(batchAlloc, count);
+       for (size_t i = 0; i < count; ++i) {
+           links[i].op = ops + i;
+           links[i].right = i + 1 < count ? links + i + 1 : nullptr;
+       }
+       try {
+           BatchLink *head = links;
+           const BatchLink *sorted = sortChain(head, count), *last = sorted;
+           while (last->right) last = last->right;
+           applySorted(sorted, last->op->key, count);
+       } catch (...) {
+           BatchTraits::deallocate(batchAlloc, links, count);
+           throw;
+       }
+       BatchTraits::deallocate(batchAlloc, links, count);
    }
 
    pair<iterator, bool> insert(const value_type &value) {
-       Node *existingNode = findNode(value.first);
-       if (existingNode) {
-           return pair<iterator, bool>(iterator(this, existingNode), false);
+       return insertValue(nullptr, value);
+   }
+
+   pair<iterator, bool> insert(value_type &&value) {
+       return insertValue(nullptr, std::move(value));
+   }
+
+   // `hint` should be the element that will follow the new one (end() when
+   // appending). A correct hint costs two comparisons and a neighbour step,
+   // which is amortized O(1) over a sorted run; a wrong one costs a normal
+   // insert.
+   iterator insert(const_iterator hint, const value_type &value) {
+       return insertValue(hintNode(hint), value).first;
+   }
+
+   iterator insert(const_iterator hint, value_type &&value) {
+       return insertValue(hintNode(hint), std::move(value)).first;
+   }
+
+   // Builds the element inside its node first and looks for its key there,
+   // so nothing is copied; the node is handed back if the key exists.
+   template<class... Args>
+   pair<iterator, bool> emplace(Args&&... args) {
+       Node *node = createNode(std::forward<Args>(args)...);
+       NodeBase *parent;
+       bool toLeft;
+       Node *existing = findInsertPos(node->data.first, parent, toLeft);
+       if (existing) {
+           dropNode(node);
+           return pair<iterator, bool>(iterator(this, existing), false);
+       }
+       attachNode(parent, toLeft, node);
+       return pair<iterator, bool>(iterator(this, node), true);
+   }
+
+   template<class... Args>
+   iterator emplace_hint(const_iterator hint, Args&&... args) {
+       Node *node = createNode(std::forward<Args>(args)...);
+       NodeBase *parent;
+       bool toLeft;
+       Node *existing = findHintPos(hintNode(hint), node->data.first, parent, toLeft);
+       if (existing) {
+           dropNode(node);
+           return iterator(this, existing);
        }
+       attachNode(parent, toLeft, node);
+       return iterator(this, node);
+   }
+
+   template<class... Args>
+   pair<iterator, bool> try_emplace(const Key &key, Args&&... args) {
+       return tryEmplace(key, std::forward<Args>(args)...);
+   }
+
+   template<class... Args>
+   pair<iterator, bool> try_emplace(Key &&key, Args&&... args) {
+       return tryEmplace(std::move(key), std::forward<Args>(args)...);
+   }
+
+   template<class M>
+   pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+       return insertOrAssign(key, std::forward<M>(obj));
+   }
 
-       root = insertNode(root, value);
-       Node *newNode = findNode(value.first);
-       return pair<iterator, bool>(iterator(this, newNode), true);
+   template<class M>
+   pair<iterator, bool> insert_or_assign(Key &&key, M &&obj) {
+       return insertOrAssign(std::move(key), std::forward<M>(obj));
    }
 
-   void erase(iterator pos) {
-       if (!pos.node || pos.container != this) {
+   iterator erase(iterator pos) {
+       if (!pos.node || pos.container != this || pos.node == &header) {
            throw invalid_iterator();
        }
 
-       root = eraseNode(root, pos.node->data.first);
+       iterator next(this, findInorderSuccessor(pos.node));
+       eraseNode(asNode(pos.node));
+       return next;
+   }
+
+   iterator erase(const_iterator first, const_iterator last) {
+       if (!first.node || !last.node || first.container != this || last.container != this) {
+           throw invalid_iterator();
+       }
+       eraseRange(first.node, last.node);
+       return iterator(this, last.node);
+   }
+
+   // Erases every key in [lo, hi) and returns how many there were.
+   size_t erase_range(const Key &lo, const Key &hi) {
+       return erase_range<Key>(lo, hi);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   size_t erase_range(const K &lo, const K &hi) {
+       if (!comp()(lo, hi)) return 0;
+       size_t before = mapSize;
+       eraseRange(lowerBoundNode(lo), lowerBoundNode(hi));
+       return before - mapSize;
+   }
+
+   // Moves every element whose key is not less than `key` into the returned
+   // map in O(log n + min(k, n - k)), where the second term counts the
+   // smaller side. The larger side keeps its nodes; the elements of the
+   // smaller side are moved into nodes of its own, which invalidates
+   // iterators and references to them, and the nodes they leave behind are
+   // reused by the larger side. If moving an element throws, this map
+   // keeps all of its elements.
+   map split(const Key &key) {
+       map upper(comp(), pool.allocator());
+       if (!root()) return upper;
+       size_t lowerSize = countBefore(lowerBoundNode(key));
+       size_t upperSize = mapSize - lowerSize;
+       NodeBase *left, *match, *right;
+       int hl, hr;
+       splitAt(root(), treeHeight(root()), key, left, hl, match, right, hr);
+       if (match) {
+           right = joinTrees(nullptr, 0, match, right, hr, hr);
+       }
+       bool upperSmaller = upperSize <= lowerSize;
+       NodeBase *&smaller = upperSmaller ? right : left;
+       int &smallerHeight = upperSmaller ? hr : hl;
+       size_t smallerSize = upperSmaller ? upperSize : lowerSize;
+       NodeBase chain;
+       chainTree(smaller, &chain)->right = nullptr;
+       NodeBase *moved;
+       try {
+           moved = upper.relocateChain(chain.right, smallerSize);
+       } catch (...) {
+           NodeBase *head = chain.right;
+           smaller = buildBalanced(head, smallerSize);
+           smallerHeight = bitWidth(smallerSize);
+           int h;
+           setRoot(joinTrees(left, hl, right, hr, h), mapSize);
+           throw;
+       }
+       dropChain(chain.right);
+       if (upperSmaller) {
+           upper.setRoot(moved, upperSize);
+           setRoot(left, lowerSize);
+       } else {
+           pool.swap(upper.pool);
+           upper.setRoot(right, upperSize);
+           setRoot(moved, lowerSize);
+       }
+       return upper;
+   }
+
+   // Moves all of `other` into this map in O(log n). Every key of `other`
+   // must be greater than every key here, or every one smaller; otherwise
+   // runtime_error is thrown and neither map changes.
+   void join(map &other) {
+       if (this == &other || !other.root()) return;
+       if (!root()) {
+           if (pool.allocator() == other.pool.allocator()) {
+               swap(other);
+           } else {
+               for (const_iterator it = other.cbegin(); it != other.cend(); ++it) {
+                   insert(end(), *it);
+               }
+               other.clear();
+           }
+           return;
+       }
+       bool after = comp()(keyOf(rightmost), keyOf(other.leftmost));
+       if (!after && !comp()(keyOf(other.rightmost), keyOf(leftmost))) {
+           throw runtime_error();
+       }
+       if (!(pool.allocator() == other.pool.allocator())) {
+           map moved(comp(), pool.allocator());
+           for (iterator it = other.begin(); it != other.end(); ++it) {
+               moved.insert(moved.end(), std::move(*it));
+           }
+           other.clear();
+           join(moved);
+           return;
+       }
+       int h1 = treeHeight(root()), h2, h;
+       size_t size2;
+       NodeBase *t2 = adoptTree(other, h2, size2);
+       NodeBase *t = after ? joinTrees(root(), h1, t2, h2, h) : joinTrees(t2, h2, root(), h1, h);
+       setRoot(t, mapSize + size2);
+   }
+
+   void join(map &&other) {
+       join(other);
+   }
+
+   // Adds every element of `other` whose key is missing here. For keys in
+   // both, resolve(mine, theirs) may update this map's value; by default
+   // it is kept. An rvalue `other` with an equal allocator hands over its
+   // nodes instead of having them copied, and is left empty.
+   template<class Resolve>
+   void merge_union(map &&other, Resolve resolve) {
+       if (this == &other) return;
+       if (pool.allocator() == other.pool.allocator()) {
+           uniteAdopted(other, resolve);
+       } else {
+           merge_union(static_cast<const map&>(other), resolve);
+           other.clear();
+       }
+   }
+
+   template<class Resolve>
+   void merge_union(const map &other, Resolve resolve) {
+       if (this == &other) return;
+       map copy(comp(), pool.allocator());
+       copy.copyTree(other);
+       uniteAdopted(copy, resolve);
+   }
+
+   void merge_union(map &&other) {
+       merge_union(std::move(other), KeepMine());
+   }
+
+   void merge_union(const map &other) {
+       merge_union(other, KeepMine());
+   }
+
+   // Keeps only the keys also present in `other`, calling
+   // resolve(mine, theirs) for each of them.
+   template<class Resolve>
+   void intersection(const map &other, Resolve resolve) {
+       if (this == &other) return;
+       if (mapSize * lopsidedIntersectionRatio <= other.mapSize) {
+           NodeBase chain, kept;
+           NodeBase *tail = &kept, *finger = nullptr;
+           bool fingers = walkWithFinger(mapSize, other.mapSize);
+           size_t n = 0;
+           chainTree(root(), &chain)->right = nullptr;
+           for (NodeBase *node = chain.right; node;) {
+               NodeBase *next = node->right;
+               Node *match = other.walkFind(finger, keyOf(node));
+               if (match) {
+                   pushPath(match);
+                   const T &theirs = match->data.second;
+                   resolve(asNode(node)->data.second, theirs);
+                   tail = tail->right = node;
+                   if (fingers) finger = match;
+                   ++n;
+               } else {
+                   dropNode(asNode(node));
+               }
+               node = next;
+           }
+           tail->right = nullptr;
+           NodeBase *head = kept.right;
+           setRoot(buildBalanced(head, n), n);
+           return;
+       }
+       size_t kept = 0;
+       int h;
+       NodeBase *t = intersectTrees(root(), treeHeight(root()), other.root(), treeHeight(other.root()),
+                                    resolve, kept, h);
+       setRoot(t, kept);
+   }
+
+   void intersection(const map &other) {
+       intersection(other, KeepMine());
+   }
+
+   // Removes every key present in `other`.
+   void difference(const map &other) {
+       if (this == &other) {
+           clear();
+           return;
+       }
+       if (other.mapSize * lopsidedDifferenceRatio <= mapSize) {
+           NodeBase *finger = nullptr;
+           bool fingers = walkWithFinger(other.mapSize, mapSize);
+           for (NodeBase *node = other.leftmost; node != &other.header; node = findInorderSuccessor(node)) {
+               Node *match = walkFind(finger, keyOf(node));
+               if (match) {
+                   NodeBase *before = fingers ? findInorderPredecessor(match) : nullptr;
+                   finger = before == &header ? nullptr : before;
+                   eraseNode(match);
+               }
+           }
+           return;
+       }
+       size_t removed = 0;
+       int h;
+       NodeBase *t = subtractTrees(root(), treeHeight(root()), other.root(), treeHeight(other.root()),
+                                   removed, h);
+       setRoot(t, mapSize - removed);
+   }
+
+   size_t erase(const Key &key) {
+       return erase<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K>,
+            class = typename std::enable_if<!std::is_convertible<K, const_iterator>::value>::type>
+   size_t erase(const K &key) {
+       Node *node = findNode(key);
+       if (!node) return 0;
+       eraseNode(node);
+       return 1;
    }
 
    size_t count(const Key &key) const {
+       return count<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   size_t count(const K &key) const {
        return findNode(key) ? 1 : 0;
    }
 
+   // Order statistics in O(log n). These need the sjtu::order_statistics
+   // policy as the fifth template argument.
+
+   // Number of keys less than `key`.
+   size_t rank(const Key &key) const {
+       return rank<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   size_t rank(const K &key) const {
+       static_assert(countsSubtrees, "rank() needs the sjtu::order_statistics policy");
+       size_t result = 0;
+       NodeBase *current = root();
+       while (current) {
+           if (comp()(keyOf(current), key)) {
+               result += subtreeSize(current->left) + 1;
+               current = current->right;
+           } else {
+               current = current->left;
+           }
+       }
+       return result;
+   }
+
+   // The k-th element in key order, counting from 0; end() if k >= size().
+   iterator select(size_t k) {
+       static_assert(countsSubtrees, "select() needs the sjtu::order_statistics policy");
+       return iterator(this, nodeAt(k));
+   }
+
+   const_iterator select(size_t k) const {
+       static_assert(countsSubtrees, "select() needs the sjtu::order_statistics policy");
+       return const_iterator(this, nodeAt(k));
+   }
+
+   // Number of keys in [lo, hi).
+   size_t count_range(const Key &lo, const Key &hi) const {
+       return count_range<Key>(lo, hi);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   size_t count_range(const K &lo, const K &hi) const {
+       return comp()(lo, hi) ? rank(hi) - rank(lo) : 0;
+   }
+
+   // `it` moved by `n` positions, which may land on end() but not beyond
+   // either end: that throws index_out_of_bound.
+   iterator advance(const_iterator it, std::ptrdiff_t n) {
+       return iterator(this, nodeAt(advancedIndex(it, n)));
+   }
+
+   const_iterator advance(const_iterator it, std::ptrdiff_t n) const {
+       return const_iterator(this, nodeAt(advancedIndex(it, n)));
+   }
+
+   std::ptrdiff_t distance(const_iterator first, const_iterator last) const {
+       static_assert(countsSubtrees, "distance() needs the sjtu::order_statistics policy");
+       if (!first.node || !last.node || first.container != this || last.container != this) {
+           throw invalid_iterator();
+       }
+       return (std::ptrdiff_t)indexOf(last.node) - (std::ptrdiff_t)indexOf(first.node);
+   }
+
+   // Range aggregates in O(log n). These need a sjtu::range_aggregate
+   // policy as the fifth template argument.
+
+   // The monoid's combination of every element with a key in [lo, hi).
+   template<class Data = AugmentData>
+   typename Data::aggregate_type aggregate(const Key &lo, const Key &hi) const {
+       return aggregate<Key, Data>(lo, hi);
+   }
+
+   template<class K, class Data = AugmentData, class = EnableLookup<K> >
+   typename Data::aggregate_type aggregate(const K &lo, const K &hi) const {
+       typename Data::monoid_type monoid;
+       if (!comp()(lo, hi)) return monoid.identity();
+       NodeBase *top = root();
+       while (top) {
+           if (comp()(keyOf(top), lo)) {
+               top = top->right;
+           } else if (!comp()(keyOf(top), hi)) {
+               top = top->left;
+           } else {
+               break;
+           }
+       }
+       if (!top) return monoid.identity();
+       // Everything in [lo, hi) lies under `top`: keys >= lo on its left,
+       // then top itself, then keys < hi on its right.
+       typename Data::aggregate_type below = monoid.identity(), above = monoid.identity();
+       for (NodeBase *n = top->left; n;) {
+           if (comp()(keyOf(n), lo)) {
+               n = n->right;
+           } else {
+               typename Data::aggregate_type part = monoid.project(keyOf(n), asNode(n)->data.second);
+               if (n->right) part = monoid.combine(part, n->right->total);
+               below = monoid.combine(part, below);
+               n = n->left;
+           }
+       }
+       for (NodeBase *n = top->right; n;) {
+           if (comp()(keyOf(n), hi)) {
+               if (n->left) above = monoid.combine(above, n->left->total);
+               above = monoid.combine(above, monoid.project(keyOf(n), asNode(n)->data.second));
+               n = n->right;
+           } else {
+               n = n->left;
+           }
+       }
+       return monoid.combine(monoid.combine(below, monoid.project(keyOf(top), asNode(top)->data.second)),
+                             above);
+   }
+
+   // The aggregate over the whole map.
+   template<class Data = AugmentData>
+   typename Data::aggregate_type aggregate() const {
+       return root() ? root()->total : typename Data::monoid_type().identity();
+   }
+
+   // Tracked writes: f(value) runs on the mapped value and the aggregates
+   // on the path to the root are recomputed, even if f throws. Returns
+   // false if `key` is absent.
+   template<class F>
+   bool update(const Key &key, F f) {
+       Node *node = findNode(key);
+       if (!node) return false;
+       updateNode(node, f);
+       return true;
+   }
+
+   template<class F>
+   void update(iterator pos, F f) {
+       if (!pos.node || pos.container != this || pos.node == &header) {
+           throw invalid_iterator();
+       }
+       updateNode(asNode(pos.node), f);
+   }
+
+   // Applies `op` to the value of every key in [lo, hi) in O(log n). Needs
+   // a sjtu::range_update policy as the fifth template argument. Values
+   // read through references taken earlier are not updated; read them
+   // again through an iterator or a lookup.
+   template<class Data = AugmentData>
+   void range_apply(const Key &lo, const Key &hi, const typename Data::op_type &op) {
+       applyRange(lo, hi, op);
+   }
+
+   template<class K, class Data = AugmentData, class = EnableLookup<K>,
+            class = typename std::enable_if<!std::is_same<K, Key>::value>::type>
+   void range_apply(const K &lo, const K &hi, const typename Data::op_type &op) {
+       applyRange(lo, hi, op);
+   }
+
    iterator find(const Key &key) {
+       return find<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   iterator find(const K &key) {
        Node *node = findNode(key);
-       return iterator(this, node);
+       return iterator(this, node ? node : &header);
    }
 
    const_iterator find(const Key &key) const {
+       return find<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   const_iterator find(const K &key) const {
        Node *node = findNode(key);
-       return const_iterator(this, node);
+       return const_iterator(this, node ? static_cast<NodeBase*>(node) : endNode());
+   }
+
+   // Ordered lookups, each a single descent. As with find(), end() means
+   // there is no such key.
+
+   // The first element whose key is not less than `key`.
+   iterator lower_bound(const Key &key) {
+       return lower_bound<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   iterator lower_bound(const K &key) {
+       return iterator(this, lowerBoundNode(key));
+   }
+
+   const_iterator lower_bound(const Key &key) const {
+       return lower_bound<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   const_iterator lower_bound(const K &key) const {
+       return const_iterator(this, lowerBoundNode(key));
+   }
+
+   // The first element whose key is greater than `key`.
+   iterator upper_bound(const Key &key) {
+       return upper_bound<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   iterator upper_bound(const K &key) {
+       return iterator(this, upperBoundNode(key));
+   }
+
+   const_iterator upper_bound(const Key &key) const {
+       return upper_bound<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   const_iterator upper_bound(const K &key) const {
+       return const_iterator(this, upperBoundNode(key));
+   }
+
+   pair<iterator, iterator> equal_range(const Key &key) {
+       return equal_range<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   pair<iterator, iterator> equal_range(const K &key) {
+       NodeBase *lower = lowerBoundNode(key);
+       return pair<iterator, iterator>(iterator(this, lower), iterator(this, equalRangeEnd(lower, key)));
+   }
+
+   pair<const_iterator, const_iterator> equal_range(const Key &key) const {
+       return equal_range<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   pair<const_iterator, const_iterator> equal_range(const K &key) const {
+       NodeBase *lower = lowerBoundNode(key);
+       return pair<const_iterator, const_iterator>(const_iterator(this, lower),
+                                                   const_iterator(this, equalRangeEnd(lower, key)));
+   }
+
+   // The element with the largest key not greater than `key`.
+   iterator floor(const Key &key) {
+       return floor<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   iterator floor(const K &key) {
+       return iterator(this, floorNode(key));
+   }
+
+   const_iterator floor(const Key &key) const {
+       return floor<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   const_iterator floor(const K &key) const {
+       return const_iterator(this, floorNode(key));
+   }
+
+   // The element with the smallest key not less than `key`; the same
+   // element as lower_bound().
+   iterator ceiling(const Key &key) {
+       return ceiling<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   iterator ceiling(const K &key) {
+       return lower_bound(key);
+   }
+
+   const_iterator ceiling(const Key &key) const {
+       return ceiling<Key>(key);
+   }
+
+   template<class K, class = EnableLookup<K> >
+   const_iterator ceiling(const K &key) const {
+       return lower_bound(key);
+   }
+
+   // Batched lookups for many independent keys. For each key in
+   // [first, last), in order, writes what find() or count() would return to
+   // `out`, and returns the end of the output. The searches are interleaved
+   // so that their memory latency overlaps, which pays off once the map no
+   // longer fits in cache. The keys must be Key, or any type the
+   // comparator accepts when it is transparent, as with find().
+   template<class ForwardIt, class OutputIt,
+            class = EnableLookup<typename std::iterator_traits<ForwardIt>::value_type> >
+   OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+       auto emit = [&](NodeBase *node) { *out++ = iterator(this, node ? node : &header); };
+       findBatch(first, last, emit);
+       return out;
+   }
+
+   template<class ForwardIt, class OutputIt,
+            class = EnableLookup<typename std::iterator_traits<ForwardIt>::value_type> >
+   OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+       auto emit = [&](NodeBase *node) { *out++ = const_iterator(this, node ? node : endNode()); };
+       findBatch(first, last, emit);
+       return out;
+   }
+
+   template<class ForwardIt, class OutputIt,
+            class = EnableLookup<typename std::iterator_traits<ForwardIt>::value_type> >
+   OutputIt count_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+       auto emit = [&](NodeBase *node) { *out++ = size_t(node ? 1 : 0); };
+       findBatch(first, last, emit);
+       return out;
    }
 };
 
+#ifdef SJTU_MAP_HAS_PMR
+namespace pmr {
+
+// A map whose nodes come from a std::pmr::memory_resource, e.g.
+// sjtu::pmr::map<int, int> m(&arena);
+template<class Key, class T, class Compare = std::less<Key> >
+using map = sjtu::map<Key, T, Compare, std::pmr::polymorphic_allocator<pair<const Key, T> > >;
+
+}
+#endif
+
 }
 
-#endif
\ No newline at end of file
+#endif